@@ -0,0 +1,200 @@
+//
+//  tuc-decoder-bench.c
+//  Touch Up Tools
+//
+//  Created by agent on 18.10.26.
+//
+//  Compares the reference, generic (vector kernels) and specialized report decoders on synthetic reports
+//  of the common Windows touchscreen layout, and checks that all of them produce the same contacts.
+//
+//  Build:  cc -O2 -I ../TouchUpCore -o tuc-decoder-bench tuc-decoder-bench.c ../TouchUpCore/HIDReport*.c ../TouchUpCore/HIDContactKernels.c
+//  Usage:  tuc-decoder-bench [reports]
+//
+
+#include "HIDReportLayout.h"
+#include "HIDReportDecoder.h"
+#include "HIDContactKernels.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+/**
+ Builds the descriptor of a touchscreen with `numContacts` fingers per report in the layout most Windows-certified panels use.
+ `withSize` adds width and height to every finger.
+ */
+static size_t BuildDescriptor(uint8_t *d, uint32_t numContacts, int withSize) {
+    size_t n = 0;
+#define ITEM(...) do { const uint8_t bytes[] = { __VA_ARGS__ }; memcpy(&d[n], bytes, sizeof(bytes)); n += sizeof(bytes); } while (0)
+
+    ITEM(0x05, 0x0D);                   // Usage Page (Digitizer)
+    ITEM(0x09, 0x04);                   // Usage (Touch Screen)
+    ITEM(0xA1, 0x01);                   // Collection (Application)
+    ITEM(0x85, 0x01);                   //   Report ID (1)
+
+    for (uint32_t i=0; i<numContacts; i++) {
+        ITEM(0x05, 0x0D);               //   Usage Page (Digitizer)
+        ITEM(0x09, 0x22);               //   Usage (Finger)
+        ITEM(0xA1, 0x02);               //   Collection (Logical)
+        ITEM(0x09, 0x42, 0x09, 0x47);   //     Usage (Tip Switch), Usage (Confidence)
+        ITEM(0x15, 0x00, 0x25, 0x01);   //     Logical Minimum (0), Logical Maximum (1)
+        ITEM(0x75, 0x01, 0x95, 0x02);   //     Report Size (1), Report Count (2)
+        ITEM(0x81, 0x02);               //     Input (Data, Var, Abs)
+        ITEM(0x95, 0x06, 0x81, 0x03);   //     Report Count (6), Input (Const)
+        ITEM(0x09, 0x51);               //     Usage (Contact Identifier)
+        ITEM(0x26, 0xFF, 0x00);         //     Logical Maximum (255)
+        ITEM(0x75, 0x08, 0x95, 0x01);   //     Report Size (8), Report Count (1)
+        ITEM(0x81, 0x02);               //     Input (Data, Var, Abs)
+        ITEM(0x05, 0x01);               //     Usage Page (Generic Desktop)
+        ITEM(0x26, 0xFF, 0x7F);         //     Logical Maximum (32767)
+        ITEM(0x75, 0x10);               //     Report Size (16)
+        ITEM(0x09, 0x30, 0x81, 0x02);   //     Usage (X), Input (Data, Var, Abs)
+        ITEM(0x26, 0x38, 0x48);         //     Logical Maximum (18488)
+        ITEM(0x09, 0x31, 0x81, 0x02);   //     Usage (Y), Input (Data, Var, Abs)
+        if (withSize) {
+            ITEM(0x05, 0x0D);           //     Usage Page (Digitizer)
+            ITEM(0x26, 0xFF, 0x0F);     //     Logical Maximum (4095)
+            ITEM(0x09, 0x48, 0x81, 0x02); //   Usage (Width), Input (Data, Var, Abs)
+            ITEM(0x09, 0x49, 0x81, 0x02); //   Usage (Height), Input (Data, Var, Abs)
+        }
+        ITEM(0xC0);                     //   End Collection
+    }
+
+    ITEM(0x05, 0x0D);                   //   Usage Page (Digitizer)
+    ITEM(0x09, 0x56);                   //   Usage (Relative Scan Time)
+    ITEM(0x27, 0xFF, 0xFF, 0x00, 0x00); //   Logical Maximum (65535)
+    ITEM(0x75, 0x10, 0x95, 0x01);       //   Report Size (16), Report Count (1)
+    ITEM(0x81, 0x02);                   //   Input (Data, Var, Abs)
+    ITEM(0x09, 0x54);                   //   Usage (Contact Count)
+    ITEM(0x25, 0x7F, 0x75, 0x08);       //   Logical Maximum (127), Report Size (8)
+    ITEM(0x81, 0x02);                   //   Input (Data, Var, Abs)
+    ITEM(0x85, 0x02);                   //   Report ID (2)
+    ITEM(0x09, 0x55);                   //   Usage (Contact Count Maximum)
+    ITEM(0x25, 0x0A, 0xB1, 0x02);       //   Logical Maximum (10), Feature (Data, Var, Abs)
+    ITEM(0xC0);                         // End Collection
+
+#undef ITEM
+    return n;
+}
+
+
+static void FillRandomReport(uint8_t *report, const HIDReportLayout *layout, unsigned *seed) {
+    for (size_t i=1; i<layout->reportSize; i++) {
+        report[i] = (uint8_t)rand_r(seed);
+    }
+    report[0] = layout->reportID;
+
+    // keep coordinates inside their logical range
+    for (uint32_t i=0; i<layout->numContacts; i++) {
+        const HIDField *x = &layout->contacts[i].x;
+        const HIDField *y = &layout->contacts[i].y;
+        uint32_t xValue = (uint32_t)rand_r(seed) % (uint32_t)(x->logicalMax + 1);
+        uint32_t yValue = (uint32_t)rand_r(seed) % (uint32_t)(y->logicalMax + 1);
+        report[x->bitOffset / 8]     = xValue & 0xFF;
+        report[x->bitOffset / 8 + 1] = xValue >> 8;
+        report[y->bitOffset / 8]     = yValue & 0xFF;
+        report[y->bitOffset / 8 + 1] = yValue >> 8;
+    }
+}
+
+
+static int FramesEqual(const HIDContactFrame *a, const HIDContactFrame *b) {
+    if (a->contactCount != b->contactCount || a->scanTime != b->scanTime || a->numContacts != b->numContacts) {
+        return 0;
+    }
+    for (uint32_t i=0; i<a->numContacts; i++) {
+        if (a->contactID[i] != b->contactID[i] || a->tipSwitch[i] != b->tipSwitch[i] || a->confidence[i] != b->confidence[i]) {
+            return 0;
+        }
+        if (a->rawX[i] != b->rawX[i] || a->rawY[i] != b->rawY[i]) {
+            return 0;
+        }
+        // the reference divides, the kernels multiply with the reciprocal
+        if (a->x[i] - b->x[i] > 1e-6f || b->x[i] - a->x[i] > 1e-6f || a->y[i] - b->y[i] > 1e-6f || b->y[i] - a->y[i] > 1e-6f) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+static double Seconds(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+
+static double Measure(HIDReportDecoderFunction decode, const HIDReportLayout *layout,
+                      const uint8_t *reports, size_t numReports, size_t iterations, float *checksum) {
+    HIDContactFrame frame;
+    double start = Seconds();
+
+    for (size_t n=0; n<iterations; n++) {
+        const uint8_t *report = &reports[(n % numReports) * layout->reportSize];
+        decode(layout, report, layout->reportSize, &frame);
+        *checksum += frame.x[frame.numContacts - 1];
+    }
+    return (Seconds() - start) * 1e9 / (double)iterations;
+}
+
+
+int main(int argc, char *argv[]) {
+    size_t iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : 5000000;
+    const size_t numReports = 1024;
+    const uint32_t contactCounts[] = { 1, 2, 5, 10 };
+
+    printf("kernels: %s\n", HIDContactKernelsInstructionSet());
+    printf("%-10s %-16s %12s %12s %12s %16s\n", "layout", "decoder", "reference ns", "generic ns", "special ns", "generic/special");
+
+    for (int withSize=0; withSize<=1; withSize++) {
+        for (size_t c=0; c<sizeof(contactCounts)/sizeof(contactCounts[0]); c++) {
+            uint8_t descriptor[4096];
+            size_t length = BuildDescriptor(descriptor, contactCounts[c], withSize);
+
+            HIDReportLayout layout;
+            if (!HIDReportLayoutCompile(descriptor, length, &layout)) {
+                fprintf(stderr, "could not compile layout with %u contacts\n", contactCounts[c]);
+                return 1;
+            }
+
+            HIDReportDecoder decoder = HIDReportDecoderForLayout(&layout);
+
+            unsigned seed = 42;
+            uint8_t *reports = malloc(numReports * layout.reportSize);
+            for (size_t i=0; i<numReports; i++) {
+                FillRandomReport(&reports[i * layout.reportSize], &layout, &seed);
+            }
+
+            for (size_t i=0; i<numReports; i++) {
+                HIDContactFrame expected, generic, special;
+                HIDDecodeReportReference(&layout, &reports[i * layout.reportSize], layout.reportSize, &expected);
+                HIDDecodeReportGeneric(&layout, &reports[i * layout.reportSize], layout.reportSize, &generic);
+                decoder.decode(&layout, &reports[i * layout.reportSize], layout.reportSize, &special);
+                if (!FramesEqual(&expected, &generic)) {
+                    fprintf(stderr, "generic decoder differs from reference in report %zu\n", i);
+                    return 1;
+                }
+                if (!FramesEqual(&expected, &special)) {
+                    fprintf(stderr, "decoder '%s' differs from reference in report %zu\n", decoder.name, i);
+                    return 1;
+                }
+            }
+
+            float checksum = 0;
+            double reference = Measure(HIDDecodeReportReference, &layout, reports, numReports, iterations, &checksum);
+            double generic   = Measure(HIDDecodeReportGeneric, &layout, reports, numReports, iterations, &checksum);
+            double special   = Measure(decoder.decode, &layout, reports, numReports, iterations, &checksum);
+
+            char name[32];
+            snprintf(name, sizeof(name), "%ux%u", contactCounts[c], withSize ? 10 : 6);
+            printf("%-10s %-16s %12.1f %12.1f %12.1f %15.2fx  (%g)\n", name, decoder.name, reference, generic, special,
+                   generic / special, checksum);
+
+            free(reports);
+        }
+    }
+    return 0;
+}
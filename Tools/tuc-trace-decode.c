@@ -0,0 +1,245 @@
+//
+//  tuc-trace-decode.c
+//  Touch Up Tools
+//
+//  Created by agent on 18.10.26.
+//
+//  Turns a binary trace written by TUCTraceStart() into a readable timeline.
+//  With -s, prints a summary of the latency measurements in the trace instead.
+//
+//  Build:  cc -O2 -I ../TouchUpCore -o tuc-trace-decode tuc-trace-decode.c
+//  Usage:  tuc-trace-decode [-l level] [-s] trace.bin
+//
+
+#include "TUCTrace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+typedef struct {
+    const char *name;
+    const char *types;
+    const char *labels[4];
+} EventDescription;
+
+static const EventDescription gEvents[] = {
+#define TUC_TRACE_EVENT_DESCRIPTION(name, types, a0, a1, a2, a3) { #name, types, { a0, a1, a2, a3 } },
+    TUC_TRACE_EVENTS(TUC_TRACE_EVENT_DESCRIPTION)
+#undef TUC_TRACE_EVENT_DESCRIPTION
+};
+
+static const char gLevelNames[] = "-EIDV";
+
+
+
+static int CompareRecords(const void *a, const void *b) {
+    uint64_t ta = ((const TUCTraceRecord *)a)->timestamp;
+    uint64_t tb = ((const TUCTraceRecord *)b)->timestamp;
+    return (ta > tb) - (ta < tb);
+}
+
+
+static void PrintRecord(const TUCTraceRecord *record, double ms, double deltaMs) {
+    char level = record->level < sizeof(gLevelNames) - 1 ? gLevelNames[record->level] : '?';
+    printf("%12.4f ms  %+9.4f  %c  [%6u]  ", ms, deltaMs, level, record->thread);
+
+    if (record->event >= TUCTraceEventCount) {
+        printf("Event#%u %lld %lld %lld %lld\n", record->event,
+               (long long)record->args[0], (long long)record->args[1], (long long)record->args[2], (long long)record->args[3]);
+        return;
+    }
+
+    const EventDescription *event = &gEvents[record->event];
+    printf("%-18s", event->name);
+
+    for (int i=0; i<4 && event->types[i] != '\0'; i++) {
+        int64_t arg = record->args[i];
+        printf(" %s=", event->labels[i]);
+
+        switch (event->types[i]) {
+            case 'x': printf("%#llx", (unsigned long long)arg); break;
+            case 'f': {
+                double value;
+                memcpy(&value, &arg, sizeof(value));
+                printf("%.5f", value);
+                break;
+            }
+            default:  printf("%lld", (long long)arg); break;
+        }
+    }
+    printf("\n");
+}
+
+
+static int CompareDurations(const void *a, const void *b) {
+    int64_t da = *(const int64_t *)a;
+    int64_t db = *(const int64_t *)b;
+    return (da > db) - (da < db);
+}
+
+
+static void PrintDurations(const char *title, int64_t *durations, size_t count) {
+    if (count == 0) {
+        printf("%-28s      -\n", title);
+        return;
+    }
+    qsort(durations, count, sizeof(int64_t), CompareDurations);
+
+    double sum = 0;
+    for (size_t i=0; i<count; i++) {
+        sum += (double)durations[i];
+    }
+    printf("%-28s %6zu   mean %8.2f ms   median %8.2f ms   p95 %8.2f ms\n", title, count,
+           sum / (double)count / 1e6, (double)durations[count / 2] / 1e6, (double)durations[(count * 95) / 100] / 1e6);
+}
+
+
+/**
+ Speculative presses: how they ended, and for clicks how much earlier the mouse down was sent than it would have been on lift.
+ Device bring-up: time from matching until the device was ready and until its first event.
+ Backlogs: how often ingestion fell behind and how many reports were merged or lost.
+ Report rates: every measured rate of the touchscreen, with the feature report changes in between.
+ */
+static void PrintSummary(const TUCTraceRecord *records, size_t count) {
+    int64_t *saved  = malloc((count + 1) * sizeof(int64_t));
+    int64_t *ready  = malloc((count + 1) * sizeof(int64_t));
+    int64_t *first  = malloc((count + 1) * sizeof(int64_t));
+    size_t numSaved = 0, numReady = 0, numFirst = 0;
+    size_t outcomes[TUCTracePressCancelled + 1] = { 0 };
+    size_t numBacklogs = 0;
+    int64_t merged = 0, dropped = 0;
+    const TUCTraceRecord **rates = malloc((count + 1) * sizeof(TUCTraceRecord *));
+    size_t numRates = 0;
+
+    for (size_t i=0; i<count; i++) {
+        const TUCTraceRecord *record = &records[i];
+
+        if (record->event == TUCTraceEventSpeculativePress
+            && record->args[0] >= TUCTracePressBegan && record->args[0] <= TUCTracePressCancelled) {
+            outcomes[record->args[0]]++;
+            if (record->args[0] == TUCTracePressClicked) {
+                saved[numSaved++] = record->args[1];
+            }
+        } else if (record->event == TUCTraceEventDeviceReady) {
+            ready[numReady++] = record->args[1];
+        } else if (record->event == TUCTraceEventFirstEvent) {
+            first[numFirst++] = record->args[1];
+        } else if (record->event == TUCTraceEventBacklog) {
+            numBacklogs++;
+            merged  += record->args[0];
+            dropped  = record->args[2];
+        } else if (record->event == TUCTraceEventDigitizerProfile || record->event == TUCTraceEventDeviceConfigured) {
+            rates[numRates++] = record;
+        }
+    }
+
+    printf("speculative presses: %zu began, %zu clicked, %zu dragged, %zu cancelled\n",
+           outcomes[TUCTracePressBegan], outcomes[TUCTracePressClicked],
+           outcomes[TUCTracePressDragged], outcomes[TUCTracePressCancelled]);
+    PrintDurations("latency saved per click", saved, numSaved);
+    PrintDurations("device ready after", ready, numReady);
+    PrintDurations("first event after", first, numFirst);
+    printf("backlogs: %zu, %lld reports merged, %lld dropped by then\n", numBacklogs, (long long)merged, (long long)dropped);
+
+    printf("report rates:");
+    for (size_t i=0; i<numRates; i++) {
+        if (rates[i]->event == TUCTraceEventDeviceConfigured) {
+            printf(" -> usage %#llx set to %lld ->", (unsigned long long)rates[i]->args[0], (long long)rates[i]->args[1]);
+        } else {
+            double rate;
+            memcpy(&rate, &rates[i]->args[0], sizeof(rate));
+            printf(" %.1f Hz", rate);
+        }
+    }
+    printf("%s\n", numRates == 0 ? " none measured" : "");
+
+    free(rates);
+    free(saved);
+    free(ready);
+    free(first);
+}
+
+
+int main(int argc, char *argv[]) {
+    int maxLevel = TUCTraceLevelVerbose;
+    int summary = 0;
+
+    int option;
+    while ((option = getopt(argc, argv, "l:s")) != -1) {
+        if (option == 'l') {
+            maxLevel = atoi(optarg);
+        } else if (option == 's') {
+            summary = 1;
+        } else {
+            fprintf(stderr, "usage: %s [-l level] [-s] trace.bin\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-l level] [-s] trace.bin\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(argv[optind], "rb");
+    if (!file) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    TUCTraceFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != TUC_TRACE_FILE_MAGIC) {
+        fprintf(stderr, "%s: not a Touch Up trace\n", argv[optind]);
+        return 1;
+    }
+    if (header.version != TUC_TRACE_FILE_VERSION || header.recordSize != sizeof(TUCTraceRecord)) {
+        fprintf(stderr, "%s: unsupported trace version %u\n", argv[optind], header.version);
+        return 1;
+    }
+
+    size_t capacity = 4096;
+    size_t count = 0;
+    TUCTraceRecord *records = malloc(capacity * sizeof(TUCTraceRecord));
+
+    while (records && fread(&records[count], sizeof(TUCTraceRecord), 1, file) == 1) {
+        if (++count == capacity) {
+            capacity *= 2;
+            records = realloc(records, capacity * sizeof(TUCTraceRecord));
+        }
+    }
+    fclose(file);
+
+    if (!records) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    // every thread's ring is written in chunks, so the file is only ordered per thread
+    qsort(records, count, sizeof(TUCTraceRecord), CompareRecords);
+
+    if (summary) {
+        PrintSummary(records, count);
+        free(records);
+        return 0;
+    }
+
+    double nsPerTick = (double)header.timebaseNumer / (double)header.timebaseDenom;
+    uint64_t start = count > 0 ? records[0].timestamp : 0;
+    uint64_t previous = start;
+
+    for (size_t i=0; i<count; i++) {
+        if (records[i].level > maxLevel) {
+            continue;
+        }
+        double ms = (double)(records[i].timestamp - start) * nsPerTick / 1e6;
+        double deltaMs = (double)(records[i].timestamp - previous) * nsPerTick / 1e6;
+        previous = records[i].timestamp;
+
+        PrintRecord(&records[i], ms, deltaMs);
+    }
+
+    free(records);
+    return 0;
+}
@@ -0,0 +1,662 @@
+//
+//  tuc-unit-tests.c
+//  Touch Up Tools
+//
+//  Created by agent on 18.10.26.
+//
+//  Unit checks for the pure C parts of TouchUpCore that work without a device: descriptor parsing, report layouts, the
+//  specialized decoders against the reference decoder, the vector kernels against their scalar reference, the frame pipeline,
+//  motion history, digitizer profile and the similarity fit, contact set and gesture lock of the multi-finger recognizer. Prints
+//  every failed check and exits with 1 if there was one.
+//
+//  Build:  cc -O2 -I ../TouchUpCore -o tuc-unit-tests tuc-unit-tests.c ../TouchUpCore/HIDReport*.c
+//              ../TouchUpCore/HIDContactKernels.c ../TouchUpCore/HIDFramePipeline.c ../TouchUpCore/TUCMotionHistory.c
+//              ../TouchUpCore/TUCDigitizerProfile.c ../TouchUpCore/TUCContactStatistics.c
+//  Usage:  tuc-unit-tests
+//
+
+#include "HIDReportLayout.h"
+#include "HIDReportDecoder.h"
+#include "HIDContactKernels.h"
+#include "HIDFramePipeline.h"
+#include "TUCMotionHistory.h"
+#include "TUCDigitizerProfile.h"
+#include "TUCContactStatistics.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static int gNumChecks;
+static int gNumFailures;
+
+#define CHECK(condition) do {                                                           \
+    gNumChecks++;                                                                       \
+    if (!(condition)) {                                                                 \
+        gNumFailures++;                                                                 \
+        fprintf(stderr, "%s:%d: %s: check failed: %s\n", __FILE__, __LINE__, __func__, #condition); \
+    }                                                                                   \
+} while (0)
+
+#define CHECK_CLOSE(value, expected, tolerance) CHECK(fabs((double)(value) - (double)(expected)) <= (tolerance))
+
+
+
+#pragma mark - Descriptors
+
+#define ITEM(...) do { const uint8_t bytes[] = { __VA_ARGS__ }; memcpy(&d[n], bytes, sizeof(bytes)); n += sizeof(bytes); } while (0)
+
+/**
+ Two fingers in the byte aligned block of Windows-certified panels, scan time, contact count,
+ and Contact Count Maximum in feature report 2.
+ */
+static size_t BuildAlignedDescriptor(uint8_t *d) {
+    size_t n = 0;
+    ITEM(0x05, 0x0D);                   // Usage Page (Digitizer)
+    ITEM(0x09, 0x04);                   // Usage (Touch Screen)
+    ITEM(0xA1, 0x01);                   // Collection (Application)
+    ITEM(0x85, 0x01);                   //   Report ID (1)
+
+    for (int i=0; i<2; i++) {
+        ITEM(0x05, 0x0D);               //   Usage Page (Digitizer)
+        ITEM(0x09, 0x22);               //   Usage (Finger)
+        ITEM(0xA1, 0x02);               //   Collection (Logical)
+        ITEM(0x09, 0x42, 0x09, 0x47);   //     Usage (Tip Switch), Usage (Confidence)
+        ITEM(0x15, 0x00, 0x25, 0x01);   //     Logical Minimum (0), Logical Maximum (1)
+        ITEM(0x75, 0x01, 0x95, 0x02);   //     Report Size (1), Report Count (2)
+        ITEM(0x81, 0x02);               //     Input (Data, Var, Abs)
+        ITEM(0x95, 0x06, 0x81, 0x03);   //     Report Count (6), Input (Const)
+        ITEM(0x09, 0x51);               //     Usage (Contact Identifier)
+        ITEM(0x26, 0xFF, 0x00);         //     Logical Maximum (255)
+        ITEM(0x75, 0x08, 0x95, 0x01);   //     Report Size (8), Report Count (1)
+        ITEM(0x81, 0x02);               //     Input (Data, Var, Abs)
+        ITEM(0x05, 0x01);               //     Usage Page (Generic Desktop)
+        ITEM(0x26, 0xFF, 0x7F);         //     Logical Maximum (32767)
+        ITEM(0x75, 0x10);               //     Report Size (16)
+        ITEM(0x09, 0x30, 0x81, 0x02);   //     Usage (X), Input (Data, Var, Abs)
+        ITEM(0x26, 0x38, 0x48);         //     Logical Maximum (18488)
+        ITEM(0x09, 0x31, 0x81, 0x02);   //     Usage (Y), Input (Data, Var, Abs)
+        ITEM(0xC0);                     //   End Collection
+    }
+
+    ITEM(0x05, 0x0D);                   //   Usage Page (Digitizer)
+    ITEM(0x09, 0x56);                   //   Usage (Relative Scan Time)
+    ITEM(0x27, 0xFF, 0xFF, 0x00, 0x00); //   Logical Maximum (65535)
+    ITEM(0x75, 0x10, 0x95, 0x01);       //   Report Size (16), Report Count (1)
+    ITEM(0x81, 0x02);                   //   Input (Data, Var, Abs)
+    ITEM(0x09, 0x54);                   //   Usage (Contact Count)
+    ITEM(0x25, 0x7F, 0x75, 0x08);       //   Logical Maximum (127), Report Size (8)
+    ITEM(0x81, 0x02);                   //   Input (Data, Var, Abs)
+    ITEM(0x85, 0x02);                   //   Report ID (2)
+    ITEM(0x09, 0x55);                   //   Usage (Contact Count Maximum)
+    ITEM(0x25, 0x0A, 0xB1, 0x02);       //   Logical Maximum (10), Feature (Data, Var, Abs)
+    ITEM(0xC0);                         // End Collection
+    return n;
+}
+
+/**
+ Three fingers packed into 32 bits each without padding: tip switch, 5 bit contact ID, and 13 bit coordinates with a negative
+ minimum, which the packed kernels cannot load. No report ID, contact count or scan time.
+ */
+static size_t BuildPackedDescriptor(uint8_t *d) {
+    size_t n = 0;
+    ITEM(0x05, 0x0D);                   // Usage Page (Digitizer)
+    ITEM(0x09, 0x04);                   // Usage (Touch Screen)
+    ITEM(0xA1, 0x01);                   // Collection (Application)
+
+    for (int i=0; i<3; i++) {
+        ITEM(0x09, 0x22);               //   Usage (Finger)
+        ITEM(0xA1, 0x02);               //   Collection (Logical)
+        ITEM(0x05, 0x0D);               //     Usage Page (Digitizer)
+        ITEM(0x09, 0x42);               //     Usage (Tip Switch)
+        ITEM(0x15, 0x00, 0x25, 0x01);   //     Logical Minimum (0), Logical Maximum (1)
+        ITEM(0x75, 0x01, 0x95, 0x01);   //     Report Size (1), Report Count (1)
+        ITEM(0x81, 0x02);               //     Input (Data, Var, Abs)
+        ITEM(0x09, 0x51);               //     Usage (Contact Identifier)
+        ITEM(0x25, 0x1F, 0x75, 0x05);   //     Logical Maximum (31), Report Size (5)
+        ITEM(0x81, 0x02);               //     Input (Data, Var, Abs)
+        ITEM(0x05, 0x01);               //     Usage Page (Generic Desktop)
+        ITEM(0x16, 0x00, 0xF0);         //     Logical Minimum (-4096)
+        ITEM(0x26, 0xFF, 0x0F);         //     Logical Maximum (4095)
+        ITEM(0x75, 0x0D, 0x95, 0x02);   //     Report Size (13), Report Count (2)
+        ITEM(0x09, 0x30, 0x09, 0x31);   //     Usage (X), Usage (Y)
+        ITEM(0x81, 0x02);               //     Input (Data, Var, Abs)
+        ITEM(0x05, 0x0D);               //     Usage Page (Digitizer)
+        ITEM(0xC0);                     //   End Collection
+    }
+    ITEM(0xC0);                         // End Collection
+    return n;
+}
+
+#undef ITEM
+
+
+typedef struct {
+    uint32_t numInput;
+    uint32_t numFeature;
+    uint32_t numConstant;
+    uint32_t lastFingerCollection;
+    uint32_t numFingerCollections;
+    HIDDescriptorField contactCountMaximum;
+} DescriptorCounts;
+
+static void CountField(const HIDDescriptorField *field, void *context) {
+    DescriptorCounts *counts = context;
+
+    counts->numInput    += field->type == HIDReportTypeInput;
+    counts->numFeature  += field->type == HIDReportTypeFeature;
+    counts->numConstant += field->isConstant;
+
+    if (field->collectionUsage == HIDUsage(0x0D, 0x22) && field->collectionIndex != counts->lastFingerCollection) {
+        counts->lastFingerCollection = field->collectionIndex;
+        counts->numFingerCollections++;
+    }
+    if (field->usage == HIDUsage(0x0D, 0x55)) {
+        counts->contactCountMaximum = *field;
+    }
+}
+
+
+static void TestDescriptorWalk(void) {
+    uint8_t descriptor[1024];
+    size_t length = BuildAlignedDescriptor(descriptor);
+
+    DescriptorCounts counts = {0};
+    CHECK(HIDDescriptorWalk(descriptor, length, CountField, &counts));
+
+    // per finger: tip switch, confidence, 6 padding bits, contact ID, X, Y; then scan time and contact count
+    CHECK(counts.numInput == 2 * 11 + 2);
+    CHECK(counts.numConstant == 2 * 6);
+    CHECK(counts.numFeature == 1);
+    CHECK(counts.numFingerCollections == 2);
+
+    // feature reports count their own offsets, after the report ID
+    CHECK(counts.contactCountMaximum.type == HIDReportTypeFeature);
+    CHECK(counts.contactCountMaximum.reportID == 2);
+    CHECK(counts.contactCountMaximum.field.bitOffset == 8);
+    CHECK(counts.contactCountMaximum.field.logicalMax == 10);
+    CHECK(counts.contactCountMaximum.applicationUsage == HIDUsage(0x0D, 0x04));
+
+    // truncated in the middle of an item, and a collection that is never closed
+    CHECK(!HIDDescriptorWalk(descriptor, length - 2, NULL, NULL));
+    CHECK(!HIDDescriptorWalk(descriptor, length - 1, NULL, NULL));
+    const uint8_t unbalanced[] = { 0xC0 };
+    CHECK(!HIDDescriptorWalk(unbalanced, sizeof(unbalanced), NULL, NULL));
+}
+
+
+static void TestReportLayoutCompile(void) {
+    uint8_t descriptor[1024];
+    HIDReportLayout layout;
+
+    size_t length = BuildAlignedDescriptor(descriptor);
+    CHECK(HIDReportLayoutCompile(descriptor, length, &layout));
+    CHECK(layout.reportID == 1);
+    CHECK(layout.numContacts == 2);
+    CHECK(layout.reportSize == 16);
+    CHECK(layout.descriptorHash == HIDReportDescriptorHash(descriptor, length));
+
+    for (uint32_t i=0; i<2; i++) {
+        const HIDContactLayout *contact = &layout.contacts[i];
+        uint16_t start = (uint16_t)(8 + 48 * i);
+        CHECK(contact->tipSwitch.bitOffset == start && contact->tipSwitch.bitSize == 1);
+        CHECK(contact->confidence.bitOffset == start + 1);
+        CHECK(contact->contactID.bitOffset == start + 8 && contact->contactID.bitSize == 8);
+        CHECK(contact->x.bitOffset == start + 16 && contact->x.bitSize == 16 && contact->x.logicalMax == 32767);
+        CHECK(contact->y.bitOffset == start + 32 && contact->y.logicalMax == 18488);
+        CHECK(!HIDFieldIsPresent(&contact->width));
+    }
+    CHECK(layout.scanTime.bitOffset == 104 && layout.scanTime.logicalMax == 65535);
+    CHECK(layout.contactCount.bitOffset == 120 && layout.contactCount.bitSize == 8);
+    CHECK(layout.plan.x.isPackable && layout.plan.contactID.isPackable);
+
+    length = BuildPackedDescriptor(descriptor);
+    CHECK(HIDReportLayoutCompile(descriptor, length, &layout));
+    CHECK(layout.reportID == 0);
+    CHECK(layout.numContacts == 3);
+    CHECK(layout.reportSize == 12);
+    CHECK(!HIDFieldIsPresent(&layout.contactCount) && !HIDFieldIsPresent(&layout.scanTime));
+    CHECK(layout.contacts[2].x.bitOffset == 64 + 6 && layout.contacts[2].x.isSigned);
+    CHECK(layout.contacts[2].y.bitOffset == 64 + 19 && layout.contacts[2].y.logicalMin == -4096);
+    CHECK(!layout.plan.x.isPackable && layout.plan.tipSwitch.isPackable);
+
+    // a descriptor without fingers, like a keyboard
+    const uint8_t keyboard[] = { 0x05, 0x01, 0x09, 0x06, 0xA1, 0x01, 0x75, 0x08, 0x95, 0x01, 0x81, 0x02, 0xC0 };
+    CHECK(!HIDReportLayoutCompile(keyboard, sizeof(keyboard), &layout));
+}
+
+
+static void TestFieldReadWrite(void) {
+    uint8_t report[8] = {0};
+    HIDField field = { .bitOffset = 11, .bitSize = 13, .isSigned = 1, .logicalMin = -4096, .logicalMax = 4095 };
+
+    HIDFieldWrite(report, &field, -1234);
+    CHECK(HIDFieldRead(report, &field) == -1234);
+    CHECK(report[0] == 0 && (report[1] & 0x07) == 0);
+
+    field.isSigned = 0;
+    HIDFieldWrite(report, &field, 8000);
+    CHECK(HIDFieldRead(report, &field) == 8000);
+}
+
+
+
+#pragma mark - Kernels
+
+static void FillRandomReport(uint8_t *report, const HIDReportLayout *layout, unsigned *seed) {
+    for (size_t i=0; i<layout->reportSize; i++) {
+        report[i] = (uint8_t)rand_r(seed);
+    }
+    if (layout->reportID) {
+        report[0] = layout->reportID;
+    }
+    for (uint32_t i=0; i<layout->numContacts; i++) {
+        const HIDField *x = &layout->contacts[i].x;
+        const HIDField *y = &layout->contacts[i].y;
+        HIDFieldWrite(report, x, x->logicalMin + (int32_t)((uint32_t)rand_r(seed) % (uint32_t)(x->logicalMax - x->logicalMin + 1)));
+        HIDFieldWrite(report, y, y->logicalMin + (int32_t)((uint32_t)rand_r(seed) % (uint32_t)(y->logicalMax - y->logicalMin + 1)));
+    }
+}
+
+
+static int FramesMatch(const HIDContactFrame *a, const HIDContactFrame *b) {
+    if (a->contactCount != b->contactCount || a->scanTime != b->scanTime || a->numContacts != b->numContacts) {
+        return 0;
+    }
+    for (uint32_t i=0; i<a->numContacts; i++) {
+        if (a->contactID[i] != b->contactID[i] || a->tipSwitch[i] != b->tipSwitch[i] || a->confidence[i] != b->confidence[i]
+            || a->rawX[i] != b->rawX[i] || a->rawY[i] != b->rawY[i]) {
+            return 0;
+        }
+        // the reference divides, the kernels multiply with the reciprocal
+        if (fabsf(a->x[i] - b->x[i]) > 1e-6f || fabsf(a->y[i] - b->y[i]) > 1e-6f) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+static void CheckKernelsAgainstReference(const uint8_t *descriptor, size_t length) {
+    HIDReportLayout layout;
+    CHECK(HIDReportLayoutCompile(descriptor, length, &layout));
+
+    HIDReportDecoder decoder = HIDReportDecoderForLayout(&layout);
+    unsigned seed = 7;
+    int numMismatches = 0;
+
+    for (int n=0; n<1000; n++) {
+        // exactly the size of the report, so reading past it would show up under the address sanitizer
+        uint8_t *report = malloc(layout.reportSize);
+        FillRandomReport(report, &layout, &seed);
+
+        HIDContactFrame expected, unpacked, decoded;
+        HIDDecodeReportReference(&layout, report, layout.reportSize, &expected);
+
+        memset(&unpacked, 0, sizeof(unpacked));
+        unpacked.contactCount = expected.contactCount;
+        unpacked.scanTime     = expected.scanTime;
+        unpacked.numContacts  = layout.numContacts;
+        HIDUnpackContacts(&layout, report, layout.reportSize, &unpacked);
+        HIDNormalizeContacts(&layout, &unpacked);
+
+        decoder.decode(&layout, report, layout.reportSize, &decoded);
+
+        numMismatches += !FramesMatch(&expected, &unpacked) + !FramesMatch(&expected, &decoded);
+        free(report);
+    }
+    CHECK(numMismatches == 0);
+
+    HIDContactFrame frame;
+    uint8_t shortReport[64] = {0};
+    CHECK(!HIDDecodeReportGeneric(&layout, shortReport, layout.reportSize - 1u, &frame));
+    CHECK(!HIDDecodeReportReference(&layout, shortReport, layout.reportSize - 1u, &frame));
+}
+
+
+static void TestKernels(void) {
+    uint8_t descriptor[1024];
+
+    CheckKernelsAgainstReference(descriptor, BuildAlignedDescriptor(descriptor));
+    CheckKernelsAgainstReference(descriptor, BuildPackedDescriptor(descriptor));
+
+    // corners of the logical range
+    HIDReportLayout layout;
+    HIDReportLayoutCompile(descriptor, BuildPackedDescriptor(descriptor), &layout);
+    uint8_t report[12] = {0};
+    HIDFieldWrite(report, &layout.contacts[0].x, -4096);
+    HIDFieldWrite(report, &layout.contacts[0].y, 4095);
+
+    HIDContactFrame frame;
+    CHECK(HIDDecodeReportGeneric(&layout, report, sizeof(report), &frame));
+    CHECK(frame.rawX[0] == -4096 && frame.rawY[0] == 4095);
+    CHECK_CLOSE(frame.x[0], 0, 1e-6);
+    CHECK_CLOSE(frame.y[0], 1, 1e-6);
+    CHECK(frame.contactCount == -1 && frame.scanTime == -1);
+}
+
+
+
+#pragma mark - Frame Pipeline
+
+static bool AddOne(HIDContactFrame *frame, void *context) {
+    frame->numContacts++;
+    return true;
+}
+
+static bool Double(HIDContactFrame *frame, void *context) {
+    frame->numContacts *= 2;
+    return true;
+}
+
+static bool DropEmpty(HIDContactFrame *frame, void *context) {
+    return frame->numContacts > 0;
+}
+
+
+static void TestFramePipeline(void) {
+    HIDFramePipeline pipeline;
+    HIDFramePipelineInit(&pipeline);
+
+    CHECK(HIDFramePipelineInsert(&pipeline, "double", Double, NULL, NULL));
+    CHECK(HIDFramePipelineInsert(&pipeline, "add", AddOne, NULL, "double"));
+    CHECK(!HIDFramePipelineInsert(&pipeline, "add", AddOne, NULL, NULL));
+    CHECK(!HIDFramePipelineInsert(&pipeline, "other", AddOne, NULL, "missing"));
+    CHECK(HIDFramePipelineIndexOfStage(&pipeline, "add") == 0);
+
+    // without timings nothing but the stages runs
+    HIDContactFrame frame = {0};
+    frame.numContacts = 3;
+    CHECK(HIDFramePipelineRun(&pipeline, &frame, 0));
+    CHECK(frame.numContacts == 8);
+    CHECK(pipeline.stages[0].numFrames == 0);
+
+    pipeline.measuresTimings = true;
+    frame.numContacts = 3;
+    CHECK(HIDFramePipelineRun(&pipeline, &frame, 0));
+    CHECK(frame.numContacts == 8);
+
+    frame.numContacts = 3;
+    HIDFramePipelineRun(&pipeline, &frame, 1);
+    CHECK(frame.numContacts == 6);
+
+    HIDFramePipelineSetStageEnabled(&pipeline, "add", false);
+    frame.numContacts = 3;
+    HIDFramePipelineRun(&pipeline, &frame, 0);
+    CHECK(frame.numContacts == 6);
+    CHECK(pipeline.stages[0].numFrames == 1);
+    CHECK(pipeline.stages[1].numFrames == 3);
+
+    // a stage keeps its ID while others are inserted in front of it and removed
+    uint32_t doubleID = pipeline.stages[1].stageID;
+    CHECK(HIDFramePipelineInsert(&pipeline, "drop", DropEmpty, NULL, "add"));
+    CHECK(pipeline.stages[0].stageID != doubleID && pipeline.stages[1].stageID != doubleID);
+    CHECK(HIDFramePipelineIndexOfStageID(&pipeline, doubleID) == 2);
+
+    frame.numContacts = 0;
+    CHECK(!HIDFramePipelineRun(&pipeline, &frame, 0));
+
+    CHECK(HIDFramePipelineRemove(&pipeline, "drop"));
+    CHECK(!HIDFramePipelineRemove(&pipeline, "drop"));
+    CHECK(HIDFramePipelineIndexOfStageID(&pipeline, doubleID) == 1);
+    CHECK(HIDFramePipelineIndexOfStageID(&pipeline, 0) == -1);
+
+    // a copy of the stages takes the timings over by stage ID
+    HIDFramePipeline copy = pipeline;
+    HIDFramePipelineResetTimings(&copy);
+    CHECK(HIDFramePipelineInsert(&copy, "first", AddOne, NULL, "add"));
+    HIDFramePipelineCopyTimings(&copy, &pipeline);
+    CHECK(copy.stages[0].numFrames == 0);
+    CHECK(copy.stages[2].numFrames == pipeline.stages[1].numFrames);
+    CHECK(copy.stages[2].maxNs == pipeline.stages[1].maxNs);
+}
+
+
+
+#pragma mark - Motion History
+
+static void TestMotionHistory(void) {
+    TUCMotionHistory history;
+    TUCMotionHistoryReset(&history);
+
+    CGPoint velocity, acceleration, jitter;
+    CHECK(!TUCMotionHistoryVelocity(&history, 1, &velocity));
+
+    // 120 Hz, 100 mm/s to the right, 40 mm/s² downwards; more samples than the ring holds
+    const double interval = 1.0 / 120;
+    for (int i=0; i<40; i++) {
+        double t = 10 + i * interval;
+        double dt = t - 10;
+        TUCMotionHistoryAppend(&history, t, (CGPoint){ 5 + 100 * dt, 20 * dt * dt });
+    }
+    CHECK(history.count == TUC_MOTION_HISTORY_CAPACITY);
+    CHECK_CLOSE(TUCMotionHistoryGetSample(&history, 0).timestamp, 10 + 24 * interval, 1e-9);
+    CHECK_CLOSE(TUCMotionHistoryGetSample(&history, history.count - 1).timestamp, 10 + 39 * interval, 1e-9);
+
+    CHECK(TUCMotionHistoryVelocity(&history, TUC_MOTION_VELOCITY_WINDOW, &velocity));
+    CHECK_CLOSE(velocity.x, 100, 1e-6);
+    CHECK(TUCMotionHistoryAcceleration(&history, TUC_MOTION_ACCELERATION_WINDOW, &acceleration));
+    CHECK_CLOSE(acceleration.x, 0, 1e-3);
+    CHECK_CLOSE(acceleration.y, 40, 1e-3);
+    CHECK(TUCMotionHistoryJitter(&history, TUC_MOTION_VELOCITY_WINDOW, &jitter));
+    CHECK_CLOSE(jitter.x, 0, 1e-6);
+
+    // the same timestamp replaces the newest sample
+    TUCMotionSample newest = TUCMotionHistoryGetSample(&history, history.count - 1);
+    TUCMotionHistoryAppend(&history, newest.timestamp, (CGPoint){ 0, 0 });
+    CHECK(history.count == TUC_MOTION_HISTORY_CAPACITY);
+    CHECK(TUCMotionHistoryGetSample(&history, history.count - 1).location.x == 0);
+
+    // a resting contact alternating by ±0.1 mm, the estimate leaves out the two degrees of freedom of the line
+    TUCMotionHistoryReset(&history);
+    for (int i=0; i<8; i++) {
+        TUCMotionHistoryAppend(&history, i * interval, (CGPoint){ 50 + (i % 2 ? 0.1 : -0.1), 50 });
+    }
+    CHECK(TUCMotionHistoryJitter(&history, 1, &jitter));
+    CHECK(jitter.x > 0.1 && jitter.x < 0.13);
+    CHECK_CLOSE(jitter.y, 0, 1e-9);
+
+    // too few samples in the window
+    TUCMotionHistoryReset(&history);
+    TUCMotionHistoryAppend(&history, 0, (CGPoint){ 0, 0 });
+    TUCMotionHistoryAppend(&history, 1, (CGPoint){ 1, 0 });
+    CHECK(!TUCMotionHistoryVelocity(&history, 0.5, &velocity));
+    CHECK(TUCMotionHistoryVelocity(&history, 2, &velocity));
+    CHECK(!TUCMotionHistoryAcceleration(&history, 2, &acceleration));
+}
+
+
+
+#pragma mark - Digitizer Profile
+
+static void TestDigitizerProfile(void) {
+    TUCDigitizerProfile profile;
+    TUCDigitizerProfileReset(&profile);
+
+    CHECK(TUCDigitizerProfileReportRate(&profile) == 0);
+    CHECK(TUCDigitizerProfileStationarySpeed(&profile) == TUC_STATIONARY_SPEED);
+
+    // 60 Hz with a pause in the middle, the estimate settles exactly once;
+    // the first report and the one after the pause have no interval
+    int numSettled = 0;
+    double t = 100;
+    for (int i=0; i<TUC_PROFILE_SETTLED_REPORTS + 12; i++) {
+        t += i == 20 ? 2.0 : 1.0 / 60;
+        numSettled += TUCDigitizerProfileAddReport(&profile, t);
+    }
+    CHECK(numSettled == 1);
+    CHECK(TUCDigitizerProfileIsSettled(&profile));
+    CHECK(profile.numIntervals == TUC_PROFILE_SETTLED_REPORTS + 10);
+    CHECK_CLOSE(TUCDigitizerProfileReportRate(&profile), 60, 1e-6);
+
+    // a stall is not an interval once the rate is known
+    t += 0.08;
+    CHECK(!TUCDigitizerProfileAddReport(&profile, t));
+    CHECK(profile.numIntervals == TUC_PROFILE_SETTLED_REPORTS + 10);
+
+    // four reports at 60 Hz do not fit into the default window
+    CHECK_CLOSE(TUCDigitizerProfileVelocityWindow(&profile), (TUC_PROFILE_MIN_VELOCITY_SAMPLES - 0.5) / 60, 1e-9);
+
+    // without noise the threshold stays, with a lot of it, it is capped
+    TUCDigitizerProfileAddJitter(&profile, 0);
+    CHECK(TUCDigitizerProfileStationarySpeed(&profile) == TUC_STATIONARY_SPEED);
+    TUCDigitizerProfileAddJitter(&profile, 20);
+    CHECK_CLOSE(profile.noise, 10, 1e-9);
+    CHECK(TUCDigitizerProfileStationarySpeed(&profile) == TUC_STATIONARY_SPEED_MAX);
+
+    // once settled, a single jittery contact cannot move the noise estimate far
+    for (int i=0; i<TUC_PROFILE_SETTLED_REPORTS; i++) {
+        TUCDigitizerProfileAddJitter(&profile, 0.05);
+    }
+    double noise = profile.noise;
+    TUCDigitizerProfileAddJitter(&profile, 100);
+    CHECK(profile.noise < noise * 1.1);
+}
+
+
+
+#pragma mark - Contact Statistics
+
+/**
+ Turns, scales and moves the points around their centroid.
+ */
+static void TransformContacts(const TUCContactPoint *contacts, uint32_t count, TUCSimilarityTransform transform,
+                              TUCContactPoint *result) {
+    double cx = 0, cy = 0;
+    for (uint32_t i=0; i<count; i++) {
+        cx += contacts[i].x / count;
+        cy += contacts[i].y / count;
+    }
+    double c = cos(transform.rotation) * transform.scale;
+    double s = sin(transform.rotation) * transform.scale;
+
+    for (uint32_t i=0; i<count; i++) {
+        double x = contacts[i].x - cx;
+        double y = contacts[i].y - cy;
+        result[i].contactID = contacts[i].contactID;
+        result[i].x = cx + transform.dx + c * x - s * y;
+        result[i].y = cy + transform.dy + s * x + c * y;
+    }
+}
+
+
+static void TestSimilarityTransformFit(void) {
+    const TUCContactPoint previous[3] = { { 4, 10, 10 }, { 9, 40, 12 }, { 2, 25, 35 } };
+    TUCSimilarityTransform expected = { 3, -2, 1.2, 0.3 };
+
+    TUCContactPoint current[3];
+    TransformContacts(previous, 3, expected, current);
+
+    // the order of the contacts does not matter, only their IDs
+    TUCContactPoint shuffled[3] = { current[2], current[0], current[1] };
+
+    TUCSimilarityTransform fit;
+    CHECK(TUCSimilarityTransformFit(previous, 3, shuffled, 3, &fit));
+    CHECK_CLOSE(fit.dx, expected.dx, 1e-9);
+    CHECK_CLOSE(fit.dy, expected.dy, 1e-9);
+    CHECK_CLOSE(fit.scale, expected.scale, 1e-9);
+    CHECK_CLOSE(fit.rotation, expected.rotation, 1e-9);
+
+    // a single matched contact only moves
+    const TUCContactPoint moved[2] = { { 4, 11, 13 }, { 77, 0, 0 } };
+    CHECK(TUCSimilarityTransformFit(previous, 3, moved, 2, &fit));
+    CHECK_CLOSE(fit.dx, 1, 1e-9);
+    CHECK_CLOSE(fit.dy, 3, 1e-9);
+    CHECK(fit.scale == 1 && fit.rotation == 0);
+
+    const TUCContactPoint unknown[1] = { { 77, 0, 0 } };
+    CHECK(!TUCSimilarityTransformFit(previous, 3, unknown, 1, &fit));
+
+    TUCContactStatistics statistics, reordered;
+    TUCContactStatisticsCompute(current, 3, &statistics);
+    TUCContactStatisticsCompute(shuffled, 3, &reordered);
+    CHECK(statistics.signature == reordered.signature);
+    CHECK_CLOSE(statistics.spread, reordered.spread, 1e-9);
+}
+
+
+static void TestContactSetInsert(void) {
+    TUCContactPoint contacts[TUC_GESTURE_MAX_CONTACTS];
+    uint32_t count = 0;
+
+    // twelve fingers in two different orders keep the same ten
+    for (int order=0; order<2; order++) {
+        count = 0;
+        for (int i=0; i<12; i++) {
+            int64_t contactID = order == 0 ? i : 11 - i;
+            TUCContactSetInsert(contacts, &count, (TUCContactPoint){ contactID, (double)contactID, 0 });
+        }
+        CHECK(count == TUC_GESTURE_MAX_CONTACTS);
+        for (uint32_t i=0; i<count; i++) {
+            CHECK(contacts[i].contactID == (int64_t)i && contacts[i].x == (double)i);
+        }
+    }
+}
+
+
+static TUCMultitouchKind FeedGesture(TUCSimilarityTransform step, uint32_t count, int numFrames, TUCSimilarityTransform *reported) {
+    TUCContactPoint contacts[4] = { { 1, 40, 50 }, { 2, 60, 50 }, { 3, 50, 65 }, { 4, 50, 35 } };
+    TUCMultitouchState state;
+    TUCMultitouchReset(&state);
+
+    TUCMultitouchKind kind = TUCMultitouchKindNone;
+    *reported = TUCSimilarityTransformIdentity();
+
+    for (int f=0; f<numFrames; f++) {
+        TUCSimilarityTransform delta;
+        kind = TUCMultitouchUpdate(&state, contacts, count, &delta);
+        reported->dx       += delta.dx;
+        reported->dy       += delta.dy;
+        reported->scale    *= delta.scale;
+        reported->rotation += delta.rotation;
+        TransformContacts(contacts, count, step, contacts);
+    }
+    return kind;
+}
+
+
+static void TestMultitouchRecognition(void) {
+    TUCSimilarityTransform reported;
+    const int numFrames = 30;
+
+    CHECK(FeedGesture((TUCSimilarityTransform){ 0.5, 0.1, 1, 0 }, 2, numFrames, &reported) == TUCMultitouchKindScroll);
+    CHECK(reported.scale == 1 && reported.rotation == 0);
+
+    // everything since touch down reaches the events, including what added up before the pinch was recognized
+    CHECK(FeedGesture((TUCSimilarityTransform){ 0, 0, 1.02, 0.001 }, 2, numFrames, &reported) == TUCMultitouchKindPinch);
+    CHECK_CLOSE(reported.scale, pow(1.02, numFrames - 1), 1e-9);
+    CHECK(reported.rotation == 0);
+
+    CHECK(FeedGesture((TUCSimilarityTransform){ 0, 0, 1, 0.02 }, 2, numFrames, &reported) == TUCMultitouchKindRotate);
+    CHECK_CLOSE(reported.rotation, 0.02 * (numFrames - 1), 1e-9);
+
+    CHECK(FeedGesture((TUCSimilarityTransform){ 0, -1, 1, 0 }, 3, numFrames, &reported) == TUCMultitouchKindSwipe);
+    CHECK(FeedGesture((TUCSimilarityTransform){ 0, 0, 1, 0 }, 2, numFrames, &reported) == TUCMultitouchKindNone);
+
+    TUCContactPoint single = { 1, 10, 10 };
+    TUCMultitouchState state;
+    TUCMultitouchReset(&state);
+    TUCSimilarityTransform delta;
+    CHECK(TUCMultitouchUpdate(&state, &single, 1, &delta) == TUCMultitouchKindNone);
+}
+
+
+
+int main(int argc, char *argv[]) {
+    TestDescriptorWalk();
+    TestReportLayoutCompile();
+    TestFieldReadWrite();
+    TestKernels();
+    TestFramePipeline();
+    TestMotionHistory();
+    TestDigitizerProfile();
+    TestSimilarityTransformFit();
+    TestContactSetInsert();
+    TestMultitouchRecognition();
+
+    printf("kernels: %s\n", HIDContactKernelsInstructionSet());
+    printf("%d checks, %d failed\n", gNumChecks, gNumFailures);
+    return gNumFailures > 0;
+}
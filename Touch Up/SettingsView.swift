@@ -79,6 +79,10 @@ struct SettingsView: View {
                 SettingsExplanationLabel(labels: model.uiLabels(for: \.isMagnificationEnabled))
             }
             
+            Toggle(isOn: $model.isMultiFingerSwipeEnabled) {
+                SettingsExplanationLabel(labels: model.uiLabels(for: \.isMultiFingerSwipeEnabled))
+            }
+            
             Toggle(isOn: $model.isClickWindowToFrontEnabled) {
                 SettingsExplanationLabel(labels: model.uiLabels(for: \.isClickWindowToFrontEnabled))
             }
@@ -95,6 +99,10 @@ struct SettingsView: View {
             Slider(value: $model.doubleClickDistance, in: 0...8, step: 1) {
                 SettingsExplanationLabel(labels: model.uiLabels(for: \.doubleClickDistance))
             }
+            
+            Toggle(isOn: $model.isSpeculativeTouchDownEnabled) {
+                SettingsExplanationLabel(labels: model.uiLabels(for: \.isSpeculativeTouchDownEnabled))
+            }
         }
     }
     
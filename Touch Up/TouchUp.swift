@@ -28,19 +28,26 @@ class TouchUp: NSObject, ObservableObject {
     @Published var doubleClickDistance: CGFloat = 3 //mm
     @Published var errorResistance: NSInteger = 0 // num of Reports to wait before cancelling a touch
     @Published var ignoreOriginTouches: Bool = false
+    @Published var isSpeculativeTouchDownEnabled: Bool = false
     
     
     
     @Published var isScrollingWithOneFingerEnabled = false
     @Published var isSecondaryClickEnabled = false
     @Published var isMagnificationEnabled = false
+    @Published var isMultiFingerSwipeEnabled = false
     @Published var isClickWindowToFrontEnabled = false
     @Published var isClickOnLiftEnabled = false
     
     
     
     @Published var connectedScreens = [TUCScreen]()
-    var connectedTouchscreen: TUCScreen?
+    var connectedTouchscreen: TUCScreen? {
+        didSet {
+            // screen changes replace the object, the pen thread needs a new copy of it
+            touchManager.touchscreenDidChange()
+        }
+    }
     
     var lastDateUSBAdded: Date?
     var lastDateScreenAdded: Date?
@@ -202,10 +209,12 @@ extension TouchUp {
             "doubleClickDistance" : 8,
             "errorResistance" : 4,
             "ignoreOriginTouches" : true,
+            "isSpeculativeTouchDownEnabled" : false,
             
             "isScrollingWithOneFingerEnabled" : true,
             "isSecondaryClickEnabled" : true,
             "isMagnificationEnabled" : true,
+            "isMultiFingerSwipeEnabled" : true,
             "isClickWindowToFrontEnabled" : false,
             "isClickOnLiftEnabled" : false
         ])
@@ -214,6 +223,7 @@ extension TouchUp {
         doubleClickDistance = defaults.double(forKey: "doubleClickDistance")
         errorResistance = defaults.integer(forKey: "errorResistance")
         ignoreOriginTouches = defaults.bool(forKey: "ignoreOriginTouches")
+        isSpeculativeTouchDownEnabled = defaults.bool(forKey: "isSpeculativeTouchDownEnabled")
         
         
         self.observers = [
@@ -221,7 +231,8 @@ extension TouchUp {
             $holdDuration.assign(to: \.holdDuration, on: touchManager),
             $doubleClickDistance.assign(to: \.doubleClickTolerance, on: touchManager),
             $errorResistance.assign(to: \.errorResistance, on: touchManager),
-            $ignoreOriginTouches.assign(to: \.ignoreOriginTouches, on: touchManager)
+            $ignoreOriginTouches.assign(to: \.ignoreOriginTouches, on: touchManager),
+            $isSpeculativeTouchDownEnabled.assign(to: \.speculativeTouchDown, on: touchManager)
         ]
         
         
@@ -229,6 +240,7 @@ extension TouchUp {
         isScrollingWithOneFingerEnabled = defaults.bool(forKey: "isScrollingWithOneFingerEnabled")
         isSecondaryClickEnabled = defaults.bool(forKey: "isSecondaryClickEnabled")
         isMagnificationEnabled = defaults.bool(forKey: "isMagnificationEnabled")
+        isMultiFingerSwipeEnabled = defaults.bool(forKey: "isMultiFingerSwipeEnabled")
         isClickWindowToFrontEnabled = defaults.bool(forKey: "isClickWindowToFrontEnabled")
         isClickOnLiftEnabled = defaults.bool(forKey: "isClickOnLiftEnabled")
     }
@@ -241,10 +253,12 @@ extension TouchUp {
         defaults.set(doubleClickDistance, forKey: "doubleClickDistance")
         defaults.set(errorResistance, forKey: "$errorResistance")
         defaults.set(ignoreOriginTouches, forKey: "ignoreOriginTouches")
+        defaults.set(isSpeculativeTouchDownEnabled, forKey: "isSpeculativeTouchDownEnabled")
         
         defaults.set(isScrollingWithOneFingerEnabled, forKey: "isScrollingWithOneFingerEnabled")
         defaults.set(isSecondaryClickEnabled, forKey: "isSecondaryClickEnabled")
         defaults.set(isMagnificationEnabled, forKey: "isMagnificationEnabled")
+        defaults.set(isMultiFingerSwipeEnabled, forKey: "isMultiFingerSwipeEnabled")
         defaults.set(isClickWindowToFrontEnabled, forKey: "isClickWindowToFrontEnabled")
         defaults.set(isClickOnLiftEnabled, forKey: "isClickOnLiftEnabled")
     }
@@ -256,7 +270,7 @@ extension TouchUp {
 extension TouchUp: TUCTouchDelegate {
     
     func touchesDidChange() {
-        self.touches = self.touchManager.touchSet.allObjects as! [TUCTouch]
+        self.touches = self.touchManager.currentFrame.touches
     }
     
     
@@ -288,9 +302,21 @@ extension TouchUp: TUCTouchDelegate {
         case .TUCCursorGestureTwoFingerDrag:
             return isScrollingWithOneFingerEnabled ? .drag : .scroll
             
+        case .TUCCursorGestureTwoFingerScroll:
+            return .scroll
+            
         case .TUCCursorGesturePinch:
             return isMagnificationEnabled ? .magnify : .none
             
+        case .TUCCursorGestureTwoFingerRotate:
+            return isMagnificationEnabled ? .rotate : .none
+            
+        case .TUCCursorGestureThreeFingerSwipe:
+            return isMultiFingerSwipeEnabled ? .navigateHistory : .none
+            
+        case .TUCCursorGestureFourFingerSwipe:
+            return isMultiFingerSwipeEnabled ? .switchSpace : .none
+            
         default:
             return .none
         }
@@ -337,7 +363,11 @@ extension TouchUp {
             
         case \.isMagnificationEnabled:
             return("Magnification",
-                   "Pinch two fingers to increase or decrease the size of the content. (EXPERIMENTAL)")
+                   "Pinch two fingers to increase or decrease the size of the content, or turn them to rotate it. (EXPERIMENTAL)")
+            
+        case \.isMultiFingerSwipeEnabled:
+            return("Swipe with More Fingers",
+                   "Swipe three fingers sideways to go back or forward. Swipe four fingers to switch spaces, up for Mission Control and down for App Exposé.")
             
         case \.isClickWindowToFrontEnabled:
             return("Bring Windows to Front",
@@ -351,6 +381,10 @@ extension TouchUp {
             return("Hold Duration",
                    "How long do you have to hold finger to initiate hold&drag")
             
+        case \.isSpeculativeTouchDownEnabled:
+            return("Press on Touch Down",
+                   "Press the mouse button as soon as a finger has rested on the screen for the hold duration instead of when it lifts. Held buttons react faster; moving afterwards drags.")
+            
         case \.doubleClickDistance:
             return("Double Click Zone",
                    "How many mm can two taps be apart from each other to qualify double click")
@@ -0,0 +1,237 @@
+//
+//  HIDContactKernels.c
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "HIDContactKernels.h"
+
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define HID_KERNELS_X86 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HID_KERNELS_NEON 1
+#endif
+
+/*
+ A packable value is read with one unaligned 32 bit load at its byte offset, shifted by its bit offset within that byte and masked.
+ All supported machines are little endian like HID, so the loaded word needs no swapping.
+ The plan has four bytes of slack per load: shorter reports are copied into a padded buffer first.
+ */
+
+#define HID_PADDED_REPORT_SIZE 512
+
+
+#pragma mark - Reference
+
+void HIDUnpackContactsReference(const HIDReportLayout *layout, const uint8_t *report, HIDContactFrame *frame) {
+    for (uint32_t i=0; i<layout->numContacts; i++) {
+        const HIDContactLayout *contact = &layout->contacts[i];
+
+        frame->tipSwitch[i]  = (uint32_t)HIDFieldRead(report, &contact->tipSwitch);
+        frame->confidence[i] = HIDFieldIsPresent(&contact->confidence) ? (uint32_t)HIDFieldRead(report, &contact->confidence) : 0;
+        frame->contactID[i]  = HIDFieldIsPresent(&contact->contactID)  ? (uint32_t)HIDFieldRead(report, &contact->contactID)  : 0;
+        frame->rawX[i]       = HIDFieldRead(report, &contact->x);
+        frame->rawY[i]       = HIDFieldRead(report, &contact->y);
+    }
+}
+
+
+void HIDNormalizeContactsReference(const HIDReportLayout *layout, HIDContactFrame *frame) {
+    for (uint32_t i=0; i<layout->numContacts; i++) {
+        const HIDField *x = &layout->contacts[i].x;
+        const HIDField *y = &layout->contacts[i].y;
+
+        frame->x[i] = (float)(frame->rawX[i] - x->logicalMin) / (float)(x->logicalMax - x->logicalMin);
+        frame->y[i] = (float)(frame->rawY[i] - y->logicalMin) / (float)(y->logicalMax - y->logicalMin);
+    }
+}
+
+
+
+#pragma mark - Unpacking
+
+static void UnpackFieldScalar(const HIDFieldPlan *plan, const uint8_t *report, uint32_t numContacts, uint32_t *out) {
+    for (uint32_t i=0; i<numContacts; i++) {
+        uint32_t word;
+        memcpy(&word, report + plan->byteOffset[i], sizeof(word));
+        out[i] = (word >> plan->shift[i]) & plan->mask;
+    }
+}
+
+
+#if HID_KERNELS_X86
+
+__attribute__((target("avx2")))
+static void UnpackFieldAVX2(const HIDFieldPlan *plan, const uint8_t *report, uint32_t numContacts, uint32_t *out) {
+    const __m256i mask = _mm256_set1_epi32((int)plan->mask);
+
+    for (uint32_t i=0; i<numContacts; i+=8) {
+        __m256i offsets = _mm256_loadu_si256((const __m256i *)&plan->byteOffset[i]);
+        __m256i shifts  = _mm256_loadu_si256((const __m256i *)&plan->shift[i]);
+        __m256i words   = _mm256_i32gather_epi32((const int *)report, offsets, 1);
+        _mm256_storeu_si256((__m256i *)&out[i], _mm256_and_si256(_mm256_srlv_epi32(words, shifts), mask));
+    }
+}
+
+static bool HasAVX2(void) {
+    static int hasAVX2 = -1;
+    if (hasAVX2 < 0) {
+        hasAVX2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return hasAVX2;
+}
+
+#elif HID_KERNELS_NEON
+
+static void UnpackFieldNEON(const HIDFieldPlan *plan, const uint8_t *report, uint32_t numContacts, uint32_t *out) {
+    const uint32x4_t mask = vdupq_n_u32(plan->mask);
+
+    for (uint32_t i=0; i<numContacts; i+=4) {
+        // NEON has no gather, the four loads are scalar
+        uint32_t words[4];
+        for (uint32_t k=0; k<4; k++) {
+            memcpy(&words[k], report + plan->byteOffset[i + k], sizeof(uint32_t));
+        }
+        int32x4_t  shifts = vnegq_s32(vreinterpretq_s32_u32(vld1q_u32(&plan->shift[i])));
+        uint32x4_t values = vshlq_u32(vld1q_u32(words), shifts);
+        vst1q_u32(&out[i], vandq_u32(values, mask));
+    }
+}
+
+#endif
+
+
+static void UnpackField(const HIDReportLayout *layout, const HIDFieldPlan *plan, size_t fieldOffset,
+                        const uint8_t *report, uint32_t *out) {
+    const uint32_t numContacts = layout->numContacts;
+
+    if (!plan->isPresent) {
+        memset(out, 0, numContacts * sizeof(uint32_t));
+        return;
+    }
+
+    if (!plan->isPackable) {
+        for (uint32_t i=0; i<numContacts; i++) {
+            const HIDField *field = (const HIDField *)((const uint8_t *)&layout->contacts[i] + fieldOffset);
+            out[i] = (uint32_t)HIDFieldRead(report, field);
+        }
+        return;
+    }
+
+#if HID_KERNELS_X86
+    if (HasAVX2()) {
+        UnpackFieldAVX2(plan, report, numContacts, out);
+        return;
+    }
+#elif HID_KERNELS_NEON
+    UnpackFieldNEON(plan, report, numContacts, out);
+    return;
+#endif
+
+    UnpackFieldScalar(plan, report, numContacts, out);
+}
+
+
+void HIDUnpackContacts(const HIDReportLayout *layout, const uint8_t *report, size_t length, HIDContactFrame *frame) {
+    const HIDUnpackPlan *plan = &layout->plan;
+    uint8_t padded[HID_PADDED_REPORT_SIZE];
+
+    if (length < plan->loadEnd) {
+        if (plan->loadEnd > sizeof(padded)) {
+            HIDUnpackContactsReference(layout, report, frame);
+            return;
+        }
+        memcpy(padded, report, length);
+        memset(padded + length, 0, plan->loadEnd - length);
+        report = padded;
+    }
+
+    UnpackField(layout, &plan->tipSwitch,  offsetof(HIDContactLayout, tipSwitch),  report, frame->tipSwitch);
+    UnpackField(layout, &plan->confidence, offsetof(HIDContactLayout, confidence), report, frame->confidence);
+    UnpackField(layout, &plan->contactID,  offsetof(HIDContactLayout, contactID),  report, frame->contactID);
+    UnpackField(layout, &plan->x,          offsetof(HIDContactLayout, x),          report, (uint32_t *)frame->rawX);
+    UnpackField(layout, &plan->y,          offsetof(HIDContactLayout, y),          report, (uint32_t *)frame->rawY);
+}
+
+
+
+#pragma mark - Normalization
+
+#if HID_KERNELS_X86
+
+__attribute__((target("avx2")))
+static void NormalizeAVX2(const int32_t *raw, const float *min, const float *scale, uint32_t numContacts, float *out) {
+    for (uint32_t i=0; i<numContacts; i+=8) {
+        __m256 value = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)&raw[i]));
+        value = _mm256_mul_ps(_mm256_sub_ps(value, _mm256_loadu_ps(&min[i])), _mm256_loadu_ps(&scale[i]));
+        _mm256_storeu_ps(&out[i], value);
+    }
+}
+
+static void NormalizeSSE2(const int32_t *raw, const float *min, const float *scale, uint32_t numContacts, float *out) {
+    for (uint32_t i=0; i<numContacts; i+=4) {
+        __m128 value = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)&raw[i]));
+        value = _mm_mul_ps(_mm_sub_ps(value, _mm_loadu_ps(&min[i])), _mm_loadu_ps(&scale[i]));
+        _mm_storeu_ps(&out[i], value);
+    }
+}
+
+#elif HID_KERNELS_NEON
+
+static void NormalizeNEON(const int32_t *raw, const float *min, const float *scale, uint32_t numContacts, float *out) {
+    for (uint32_t i=0; i<numContacts; i+=4) {
+        float32x4_t value = vcvtq_f32_s32(vld1q_s32(&raw[i]));
+        value = vmulq_f32(vsubq_f32(value, vld1q_f32(&min[i])), vld1q_f32(&scale[i]));
+        vst1q_f32(&out[i], value);
+    }
+}
+
+#else
+
+static void NormalizeScalar(const int32_t *raw, const float *min, const float *scale, uint32_t numContacts, float *out) {
+    for (uint32_t i=0; i<numContacts; i++) {
+        out[i] = ((float)raw[i] - min[i]) * scale[i];
+    }
+}
+
+#endif
+
+
+static void Normalize(const int32_t *raw, const float *min, const float *scale, uint32_t numContacts, float *out) {
+#if HID_KERNELS_X86
+    if (HasAVX2()) {
+        NormalizeAVX2(raw, min, scale, numContacts, out);
+    } else {
+        NormalizeSSE2(raw, min, scale, numContacts, out);
+    }
+#elif HID_KERNELS_NEON
+    NormalizeNEON(raw, min, scale, numContacts, out);
+#else
+    NormalizeScalar(raw, min, scale, numContacts, out);
+#endif
+}
+
+
+void HIDNormalizeContacts(const HIDReportLayout *layout, HIDContactFrame *frame) {
+    const HIDUnpackPlan *plan = &layout->plan;
+
+    Normalize(frame->rawX, plan->xMin, plan->xScale, layout->numContacts, frame->x);
+    Normalize(frame->rawY, plan->yMin, plan->yScale, layout->numContacts, frame->y);
+}
+
+
+
+const char *HIDContactKernelsInstructionSet(void) {
+#if HID_KERNELS_X86
+    return HasAVX2() ? "avx2" : "sse2";
+#elif HID_KERNELS_NEON
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,31 @@
+//
+//  HIDContactKernels.h
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef HIDContactKernels_h
+#define HIDContactKernels_h
+
+#include "HIDReportDecoder.h"
+
+/**
+ Kernels that work on all contacts of a report at once. Unpacking pulls tip switch, confidence, contact ID, X and Y of every
+ finger collection into the struct-of-arrays buffers of the frame, normalization turns the raw coordinates into 0...1.
+ Both use AVX2 or SSE2 on Intel and NEON on Apple silicon. The reference versions read every value on its own and are what
+ the vector versions are checked against.
+ */
+
+void HIDUnpackContacts(const HIDReportLayout *layout, const uint8_t *report, size_t length, HIDContactFrame *frame);
+void HIDNormalizeContacts(const HIDReportLayout *layout, HIDContactFrame *frame);
+
+void HIDUnpackContactsReference(const HIDReportLayout *layout, const uint8_t *report, HIDContactFrame *frame);
+void HIDNormalizeContactsReference(const HIDReportLayout *layout, HIDContactFrame *frame);
+
+/**
+ Name of the instruction set the kernels use on this machine, for traces and benchmarks.
+ */
+const char *HIDContactKernelsInstructionSet(void);
+
+#endif /* HIDContactKernels_h */
@@ -0,0 +1,143 @@
+//
+//  HIDFramePipeline.c
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "HIDFramePipeline.h"
+
+#include <string.h>
+#include <time.h>
+
+void HIDFramePipelineInit(HIDFramePipeline *pipeline) {
+    memset(pipeline, 0, sizeof(HIDFramePipeline));
+    pipeline->nextStageID = 1;
+}
+
+
+int32_t HIDFramePipelineIndexOfStage(const HIDFramePipeline *pipeline, const char *name) {
+    for (uint32_t i=0; i<pipeline->numStages; i++) {
+        if (strncmp(pipeline->stages[i].name, name, HID_FRAME_STAGE_NAME_LENGTH) == 0) {
+            return (int32_t)i;
+        }
+    }
+    return -1;
+}
+
+
+int32_t HIDFramePipelineIndexOfStageID(const HIDFramePipeline *pipeline, uint32_t stageID) {
+    for (uint32_t i=0; i<pipeline->numStages; i++) {
+        if (pipeline->stages[i].stageID == stageID) {
+            return (int32_t)i;
+        }
+    }
+    return -1;
+}
+
+
+bool HIDFramePipelineInsert(HIDFramePipeline *pipeline, const char *name, HIDFrameStageFunction process, void *context,
+                            const char *nextStage) {
+    if (pipeline->numStages == HID_FRAME_PIPELINE_MAX_STAGES || !process
+        || strlen(name) >= HID_FRAME_STAGE_NAME_LENGTH || HIDFramePipelineIndexOfStage(pipeline, name) >= 0) {
+        return false;
+    }
+
+    int32_t index = nextStage ? HIDFramePipelineIndexOfStage(pipeline, nextStage) : (int32_t)pipeline->numStages;
+    if (index < 0) {
+        return false;
+    }
+
+    memmove(&pipeline->stages[index + 1], &pipeline->stages[index], (pipeline->numStages - index) * sizeof(HIDFrameStage));
+    pipeline->numStages++;
+
+    HIDFrameStage *stage = &pipeline->stages[index];
+    memset(stage, 0, sizeof(HIDFrameStage));
+    strncpy(stage->name, name, HID_FRAME_STAGE_NAME_LENGTH - 1);
+    stage->stageID   = pipeline->nextStageID++;
+    stage->process   = process;
+    stage->context   = context;
+    stage->isEnabled = true;
+    return true;
+}
+
+
+bool HIDFramePipelineRemove(HIDFramePipeline *pipeline, const char *name) {
+    int32_t index = HIDFramePipelineIndexOfStage(pipeline, name);
+    if (index < 0 || pipeline->stages[index].isBuiltIn) {
+        return false;
+    }
+
+    pipeline->numStages--;
+    memmove(&pipeline->stages[index], &pipeline->stages[index + 1], (pipeline->numStages - index) * sizeof(HIDFrameStage));
+    return true;
+}
+
+
+void HIDFramePipelineSetStageEnabled(HIDFramePipeline *pipeline, const char *name, bool isEnabled) {
+    int32_t index = HIDFramePipelineIndexOfStage(pipeline, name);
+    if (index >= 0) {
+        pipeline->stages[index].isEnabled = isEnabled;
+    }
+}
+
+
+bool HIDFramePipelineRun(HIDFramePipeline *pipeline, HIDContactFrame *frame, uint32_t firstStage) {
+    if (!pipeline->measuresTimings) {
+        for (uint32_t i=firstStage; i<pipeline->numStages; i++) {
+            HIDFrameStage *stage = &pipeline->stages[i];
+            if (stage->isEnabled && !stage->process(frame, stage->context)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    uint64_t start = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+
+    for (uint32_t i=firstStage; i<pipeline->numStages; i++) {
+        HIDFrameStage *stage = &pipeline->stages[i];
+        if (!stage->isEnabled) {
+            continue;
+        }
+
+        bool shouldContinue = stage->process(frame, stage->context);
+
+        // the end of one stage is the start of the next
+        uint64_t end = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+        uint64_t duration = end - start;
+        start = end;
+
+        stage->numFrames++;
+        stage->totalNs += duration;
+        if (duration > stage->maxNs) {
+            stage->maxNs = duration;
+        }
+
+        if (!shouldContinue) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void HIDFramePipelineResetTimings(HIDFramePipeline *pipeline) {
+    for (uint32_t i=0; i<pipeline->numStages; i++) {
+        pipeline->stages[i].numFrames = 0;
+        pipeline->stages[i].totalNs   = 0;
+        pipeline->stages[i].maxNs     = 0;
+    }
+}
+
+
+void HIDFramePipelineCopyTimings(HIDFramePipeline *pipeline, const HIDFramePipeline *source) {
+    for (uint32_t i=0; i<pipeline->numStages; i++) {
+        int32_t index = HIDFramePipelineIndexOfStageID(source, pipeline->stages[i].stageID);
+        if (index >= 0) {
+            pipeline->stages[i].numFrames = source->stages[index].numFrames;
+            pipeline->stages[i].totalNs   = source->stages[index].totalNs;
+            pipeline->stages[i].maxNs     = source->stages[index].maxNs;
+        }
+    }
+}
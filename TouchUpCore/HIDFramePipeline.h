@@ -0,0 +1,94 @@
+//
+//  HIDFramePipeline.h
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef HIDFramePipeline_h
+#define HIDFramePipeline_h
+
+#include "HIDReportDecoder.h"
+
+/**
+ A decoded touch report passes an ordered list of stages. Every stage works in place on the same preallocated frame, so no stage
+ copies or allocates, and a disabled stage is skipped without being called. While `measuresTimings` is set, the time spent in each
+ stage is measured on the way; otherwise the stages run without any bookkeeping.
+ */
+
+#define HID_FRAME_PIPELINE_MAX_STAGES   16
+#define HID_FRAME_STAGE_NAME_LENGTH     24
+
+
+/**
+ Decoded touch reports pass these built-in stages in this order. Screens decoded via their IOHIDElements do not use the pipeline.
+ */
+#define HID_FRAME_STAGE_DECODE      "decode"    // raw report to contacts with normalized coordinates
+#define HID_FRAME_STAGE_SCAN_TIME   "scan time" // counts reports lost on the way, only enabled if the screen reports a scan time
+#define HID_FRAME_STAGE_INGEST      "ingest"    // holds back late reports that only move contacts after a stall
+#define HID_FRAME_STAGE_TRACK       "track"     // turns the contacts with the screen and updates the touches, waits for all parts of a hybrid report
+#define HID_FRAME_STAGE_GESTURES    "gestures"  // ends stale touches, recognizes gestures and posts their events
+#define HID_FRAME_STAGE_PUBLISH     "publish"   // hands the frame to the delegate of the touch manager
+
+
+/**
+ Processes the frame in place. Returning false ends the frame here: the stage dropped it, or keeps it to continue it later.
+ */
+typedef bool (*HIDFrameStageFunction)(HIDContactFrame *frame, void *context);
+
+typedef struct {
+    char     name[HID_FRAME_STAGE_NAME_LENGTH];
+    uint32_t stageID;       // unique within the pipeline, stays the same when other stages are inserted or removed
+    HIDFrameStageFunction process;
+    void    *context;
+    bool     isEnabled;
+    bool     isBuiltIn;     // part of the core, cannot be removed
+
+    uint64_t numFrames;     // frames the stage processed since the timings were reset
+    uint64_t totalNs;
+    uint64_t maxNs;
+} HIDFrameStage;
+
+typedef struct {
+    HIDFrameStage stages[HID_FRAME_PIPELINE_MAX_STAGES];
+    uint32_t numStages;
+    uint32_t nextStageID;
+    bool     measuresTimings;
+} HIDFramePipeline;
+
+
+void HIDFramePipelineInit(HIDFramePipeline *pipeline);
+
+/**
+ Inserts a stage in front of the stage named `nextStage`, or at the end if it is NULL. The new stage is enabled.
+ Returns false if the pipeline is full, the name is taken or `nextStage` does not exist.
+ */
+bool HIDFramePipelineInsert(HIDFramePipeline *pipeline, const char *name, HIDFrameStageFunction process, void *context,
+                            const char *nextStage);
+
+/**
+ Removes a stage that is not built in. Returns false if there is no such stage.
+ */
+bool HIDFramePipelineRemove(HIDFramePipeline *pipeline, const char *name);
+
+/**
+ Returns -1 if there is no such stage.
+ */
+int32_t HIDFramePipelineIndexOfStage(const HIDFramePipeline *pipeline, const char *name);
+int32_t HIDFramePipelineIndexOfStageID(const HIDFramePipeline *pipeline, uint32_t stageID);
+
+void HIDFramePipelineSetStageEnabled(HIDFramePipeline *pipeline, const char *name, bool isEnabled);
+
+/**
+ Runs the enabled stages from `firstStage` on until one of them ends the frame. Returns true if the frame passed all stages.
+ */
+bool HIDFramePipelineRun(HIDFramePipeline *pipeline, HIDContactFrame *frame, uint32_t firstStage);
+
+void HIDFramePipelineResetTimings(HIDFramePipeline *pipeline);
+
+/**
+ Copies the timings of every stage that is also in `source`, matched by stage ID. Other stages keep theirs.
+ */
+void HIDFramePipelineCopyTimings(HIDFramePipeline *pipeline, const HIDFramePipeline *source);
+
+#endif /* HIDFramePipeline_h */
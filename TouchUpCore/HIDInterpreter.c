@@ -6,14 +6,26 @@
 //
 
 #include "HIDInterpreter.h"
+#include "HIDPenInterpreter.h"
 #include "TUCTouchInputManager-C.h"
+#include "TUCTrace.h"
+#include "HIDReportLayout.h"
+#include "HIDReportDecoder.h"
+#include "HIDFramePipeline.h"
 
 #include <mach/mach_port.h>
+#include <mach/mach_time.h>
 #include <IOKit/IOKitLib.h>
 #include <IOKit/hid/IOHIDManager.h>
+#include <dispatch/dispatch.h>
+#include <stdatomic.h>
+#include <os/lock.h>
 
 #include <CoreGraphics/CoreGraphics.h>
 
+#include <stdlib.h>
+#include <string.h>
+
 #pragma mark - Global variables
 
 static void* gTouchManager;
@@ -46,6 +58,74 @@ Boolean gTouchscreenUsesHybridMode = FALSE;
 CFMutableArrayRef gContactIdentifiers;
 
 
+/**
+ If the report descriptor could be compiled, reports are decoded directly and the element queue is not used.
+ */
+Boolean                 gUsesReportDecoder = FALSE;
+IOHIDDeviceRef          gDevice;
+HIDReportLayout         gReportLayout;
+HIDReportDecoder        gReportDecoder;
+HIDContactFrame         gContactFrame;
+uint8_t                *gReportBuffer;
+CFIndex                 gReportBufferSize;
+
+
+/**
+ How the reports of the current device are decoded, and when it was matched, to measure the time until its first event.
+ */
+typedef enum {
+    DevicePathCompiledLayout,
+    DevicePathElements
+} DevicePath;
+
+DevicePath              gDevicePath;
+uint64_t                gDeviceMatchTime;
+Boolean                 gHasDispatchedFirstEvent;
+
+
+/**
+ Catching up after a stall: a decoded report that arrives late and only moves contacts waits in `gPendingFrame` and is replaced by
+ newer ones until ingestion caught up. On the element path a report is merged if the values of the next one are already queued.
+ */
+HIDIngestionCounters    gIngestionCounters;
+HIDContactFrame         gPendingFrame;
+uint32_t                gPendingFrameNextStageID;   // the stage after ingest when the frame was held back
+Boolean                 gHasPendingFrame;
+Boolean                 gIsPendingFrameFlushScheduled;
+uint64_t                gDispatchedContacts[4];     // contact IDs with tip switch in the last dispatched frame, as bit set
+Boolean                 gQueuedReportHasTransition; // a tip switch of the report on the element path changed
+uint64_t                gBacklogLength;             // merged reports since ingestion fell behind
+int32_t                 gLastScanTime = -1;
+int32_t                 gScanTimeInterval;          // smallest step between two reports seen so far
+Boolean                 gLastReportHadContacts;
+
+
+/**
+ Feature reports the touchscreen is configured with. Switching to normal latency waits until the report rate in the
+ initial mode was measured, see `HIDApplyPendingConfiguration`.
+ The reports are read and written on their own queue, the main thread only reads the outcome. Every match and removal starts
+ a new generation, so a late answer of a device that is gone is dropped.
+ */
+HIDConfigurationLayout  gConfigurationLayout;
+_Atomic bool            gHasPendingConfiguration;
+_Atomic uint32_t        gConfigurationGeneration;
+
+
+/**
+ Stages a decoded report passes, see `FramePipeline`. Custom stages stay when the device changes.
+ Every thread changes the staged pipeline under the lock and moves the generation on. The run loop takes the staged stages over
+ before the next frame, so neither side waits for the other. While a trace runs, the timings measured on the run loop are copied
+ back to the staged pipeline, which is what other threads read.
+ */
+HIDFramePipeline        gFramePipeline;             // run loop only
+uint32_t                gFramePipelineGeneration;
+HIDFramePipeline        gStagedFramePipeline;
+Boolean                 gIsFramePipelineReady;
+os_unfair_lock          gStagedFramePipelineLock = OS_UNFAIR_LOCK_INIT;
+_Atomic uint32_t        gStagedFramePipelineGeneration = 1;
+_Atomic bool            gShouldResetFrameStageTimings;
+
+
 #pragma mark General Debug Utilities
 
 
@@ -61,7 +141,7 @@ void PrintAddress(UInt8 *ptr, UInt64 length) {
 }
 
 
-void PrintInput(IOHIDValueRef inHIDValue) {
+void TraceInput(IOHIDValueRef inHIDValue) {
     IOHIDElementRef elem = IOHIDValueGetElement(inHIDValue);
     CFIndex page = IOHIDElementGetUsagePage(elem);
     CFIndex usage = IOHIDElementGetUsage(elem);
@@ -69,43 +149,7 @@ void PrintInput(IOHIDValueRef inHIDValue) {
     
     IOHIDElementCookie cookie = IOHIDElementGetCookie(elem);
     
-    char pageDescr[6]  = "(---)";
-    char usageDescr[10] = "(-------)";
-    
-    if (page == kHIDPage_GenericDesktop) {
-        strcpy(pageDescr, "(GD) ");
-        if (usage == kHIDUsage_GD_X) {
-            strcpy(usageDescr, "(X)      ");
-        } else if (usage == kHIDUsage_GD_Y) {
-            strcpy(usageDescr, "(Y)      ");
-        }
-        
-    } else if (page == kHIDPage_Digitizer) {
-        strcpy(pageDescr, "(Dig)");
-        
-        if (usage == kHIDUsage_Dig_TipSwitch) {
-            strcpy(usageDescr, "(Tip)    ");
-        } else if (usage == kHIDUsage_Dig_ContactIdentifier) {
-            strcpy(usageDescr, "(Cont ID)");
-        } else if (usage == kHIDUsage_Dig_ContactCount) {
-            strcpy(usageDescr, "(ContCnt)");
-        } else if (usage == kHIDUsage_Dig_TouchValid) {
-            strcpy(usageDescr, "(IsValid)");
-        } else if (usage == kHIDUsage_Dig_RelativeScanTime) {
-            strcpy(usageDescr, "(ScnTime)");
-        } else if (usage == kHIDUsage_Dig_Width) {
-            strcpy(usageDescr, "(Width)  ");
-        } else if (usage == kHIDUsage_Dig_Height) {
-            strcpy(usageDescr, "(Height) ");
-        } else if (usage == kHIDUsage_Dig_Azimuth) {
-            strcpy(usageDescr, "(Azimuth)");
-        }
-    }
-    
-    CFIndex  lMin = IOHIDElementGetLogicalMin(elem);
-    CFIndex lMax = IOHIDElementGetLogicalMax(elem);
-    
-    printf("%u\t| %#02lx %s\t| %#02lx %s\t|%8ld\t(%ld-%ld)\n", cookie, page, pageDescr, usage, usageDescr, value, lMin, lMax);
+    TUCTrace(TUCTraceLevelVerbose, TUCTraceEventHIDValue, cookie, page, usage, value);
 }
 
 
@@ -149,10 +193,25 @@ void StoreInputValue(IOHIDValueRef hidValue) {
     CFIndex value = IOHIDValueGetIntegerValue(hidValue);
     IOHIDElementRef elem = IOHIDValueGetElement(hidValue);
     
+    CFIndex page = IOHIDElementGetUsagePage(elem);
+    CFIndex usage = IOHIDElementGetUsage(elem);
+    
     CFIndex keyValue = StorageKeyForElement(elem);
     
     CFNumberRef key = CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &keyValue);
     
+    // a contact begins or ends in this report, so it must not be merged into the next one
+    if (page == kHIDPage_Digitizer && usage == kHIDUsage_Dig_TipSwitch) {
+        CFNumberRef previous = CFDictionaryGetValue(gStoredInputValues, key);
+        CFIndex previousValue = 0;
+        if (previous) {
+            CFNumberGetValue(previous, kCFNumberCFIndexType, &previousValue);
+        }
+        if (previousValue != value) {
+            gQueuedReportHasTransition = TRUE;
+        }
+    }
+    
     CFNumberRef num = CFNumberCreate(kCFAllocatorDefault, kCFNumberCFIndexType, &value);
     
     CFDictionarySetValue(gStoredInputValues, key, num);
@@ -162,8 +221,6 @@ void StoreInputValue(IOHIDValueRef hidValue) {
     
     
     // special case: contact count could be zero in hybrid mode --> s
-    CFIndex page = IOHIDElementGetUsagePage(elem);
-    CFIndex usage = IOHIDElementGetUsage(elem);
     
     if (page == kHIDPage_Digitizer && usage == kHIDUsage_Dig_ContactCount) {
         // hybrid mode can only exist if the old value is larger than the number of collections that can be communicated at once
@@ -182,11 +239,14 @@ void StoreInputValue(IOHIDValueRef hidValue) {
 
 
 
+void IdentifyElementsInApplicationCollection(IOHIDElementRef applicationCollection);
+
 /**
  We need to inspect the HID tree as a whole once to see which elements are grouped into logical groups of touch data.
  Just pass in any element of the tree, the function will walk up the tree, search for the logical groups and rememeber them in the global variables.
+ The tree is recorded in the trace log at debug level.
  */
-void IdentifyElements(IOHIDElementRef anyElement, Boolean printTree) {
+void IdentifyElements(IOHIDElementRef anyElement) {
     
     IOHIDElementRef applicationCollection = anyElement;
     IOHIDElementType type = kIOHIDElementTypeOutput;
@@ -201,15 +261,18 @@ void IdentifyElements(IOHIDElementRef anyElement, Boolean printTree) {
         }
     }
     
+    IdentifyElementsInApplicationCollection(applicationCollection);
+}
+
+
+void IdentifyElementsInApplicationCollection(IOHIDElementRef applicationCollection) {
     gApplicationCollectionElement = applicationCollection;
     
     
     CFArrayRef children = IOHIDElementGetChildren(applicationCollection);
     CFIndex numChildren = CFArrayGetCount(children);
     
-    if (printTree) {
-        printf("# parent (type %u) has %ld children:\n", type, numChildren);
-    }
+    TUCTrace(TUCTraceLevelDebug, TUCTraceEventElementTree, IOHIDElementGetType(applicationCollection), numChildren, 0, 0);
     
     
     for (CFIndex i=0; i<numChildren; i++) {
@@ -223,38 +286,23 @@ void IdentifyElements(IOHIDElementRef anyElement, Boolean printTree) {
         if (type == kIOHIDElementTypeCollection && collectionType == kIOHIDElementCollectionTypeLogical) {
             CFArrayAppendValue(gTouchCollectionElements, element);
             
-            if (printTree) {
-                printf(" > Logical collection %ld\n", i);
-                CFArrayRef grandchildren = IOHIDElementGetChildren(element);
-                for( CFIndex j=0; j<CFArrayGetCount(grandchildren); j++) {
-                    IOHIDElementRef gch = (IOHIDElementRef)CFArrayGetValueAtIndex(grandchildren, j);
-                    CFIndex page = IOHIDElementGetUsagePage(gch);
-                    CFIndex usage = IOHIDElementGetUsage(gch);
-                    CFIndex cookie= IOHIDElementGetCookie(gch);
-                    
-                    printf("    > %#02lx %#02lx  [%ld]\n", page, usage, cookie);
-                }
+            CFArrayRef grandchildren = IOHIDElementGetChildren(element);
+            TUCTrace(TUCTraceLevelDebug, TUCTraceEventElementCollection, i, CFArrayGetCount(grandchildren), 0, 0);
+            
+            for( CFIndex j=0; j<CFArrayGetCount(grandchildren); j++) {
+                IOHIDElementRef gch = (IOHIDElementRef)CFArrayGetValueAtIndex(grandchildren, j);
+                TUCTrace(TUCTraceLevelDebug, TUCTraceEventElementChild,
+                         IOHIDElementGetUsagePage(gch), IOHIDElementGetUsage(gch), IOHIDElementGetCookie(gch), 0);
             }
             
         } // logical collection
         
-        else if (page == kHIDPage_Digitizer && usage == kHIDUsage_Dig_ContactCount) {
-            if (printTree) {
-                printf(" > Contact Count\n");
-            }
-        }
-        
-        else if (page == kHIDPage_Digitizer && usage == kHIDUsage_Dig_RelativeScanTime) {
-            gScanTimeElement = element;
-            if (printTree) {
-                printf(" > Scan Time\n");
-            }
-        }
-        
         else {
-            if (printTree) {
-                printf(" > %#02lx %#02lx\n", page, usage);
+            if (page == kHIDPage_Digitizer && usage == kHIDUsage_Dig_RelativeScanTime) {
+                gScanTimeElement = element;
             }
+            
+            TUCTrace(TUCTraceLevelDebug, TUCTraceEventElementChild, page, usage, IOHIDElementGetCookie(element), 0);
         }
     }
 }
@@ -270,7 +318,7 @@ void IdentifyElements(IOHIDElementRef anyElement, Boolean printTree) {
 #pragma mark - Propagate Touch Data to next layer
 
 
-void PrintTouchCollection(IOHIDElementRef collection) {
+void TraceTouchCollection(IOHIDElementRef collection) {
     CFArrayRef children = IOHIDElementGetChildren(collection);
     
     // get stored values of all touches
@@ -282,44 +330,8 @@ void PrintTouchCollection(IOHIDElementRef collection) {
         CFIndex cookie = IOHIDElementGetCookie(element);
         CFIndex value = ValueOfElement(element);
         
-        char pageDescr[6]  = "(---)";
-        char usageDescr[10] = "(-------)";
-        
-        if (page == kHIDPage_GenericDesktop) {
-            strcpy(pageDescr, "(GD) ");
-            if (usage == kHIDUsage_GD_X) {
-                strcpy(usageDescr, "(X)      ");
-            } else if (usage == kHIDUsage_GD_Y) {
-                strcpy(usageDescr, "(Y)      ");
-            }
-            
-        } else if (page == kHIDPage_Digitizer) {
-            strcpy(pageDescr, "(Dig)");
-            
-            if (usage == kHIDUsage_Dig_TipSwitch) {
-                strcpy(usageDescr, "(Tip)    ");
-            } else if (usage == kHIDUsage_Dig_ContactIdentifier) {
-                strcpy(usageDescr, "(Cont ID)");
-            } else if (usage == kHIDUsage_Dig_ContactCount) {
-                strcpy(usageDescr, "(ContCnt)");
-            } else if (usage == kHIDUsage_Dig_TouchValid) {
-                strcpy(usageDescr, "(IsValid)");
-            } else if (usage == kHIDUsage_Dig_RelativeScanTime) {
-                strcpy(usageDescr, "(ScnTime)");
-            } else if (usage == kHIDUsage_Dig_Width) {
-                strcpy(usageDescr, "(Width)  ");
-            } else if (usage == kHIDUsage_Dig_Height) {
-                strcpy(usageDescr, "(Height) ");
-            } else if (usage == kHIDUsage_Dig_Azimuth) {
-                strcpy(usageDescr, "(Azimuth)");
-            }
-        }
-        
-        
-        
-        printf("[%u]\t%#02lx\t%#02lx %s\t %8ld\n", cookie, page, usage, usageDescr,  value);
+        TUCTrace(TUCTraceLevelVerbose, TUCTraceEventCollectionValue, cookie, page, usage, value);
     }
-    printf("\n");
 }
 
 
@@ -356,14 +368,14 @@ void DispatchTouchDataForCollection(IOHIDElementRef collection) {
                     CGFloat min = (CGFloat)IOHIDElementGetLogicalMin(element);
                     CGFloat max = (CGFloat)IOHIDElementGetLogicalMax(element);
                     CGFloat curr = (CGFloat)value;
-                    x = ( (curr - min) / (max - min) ) + min;
+                    x = (curr - min) / (max - min);
                 }
                 
                 else if (usage == kHIDUsage_GD_Y) {
                     CGFloat min = (CGFloat)IOHIDElementGetLogicalMin(element);
                     CGFloat max = (CGFloat)IOHIDElementGetLogicalMax(element);
                     CGFloat curr = (CGFloat)value;
-                    y = ( (curr - min) / (max - min) ) + min;
+                    y = (curr - min) / (max - min);
                 }
             } //kHIDPage_GenericDesktop
             
@@ -384,6 +396,9 @@ void DispatchTouchDataForCollection(IOHIDElementRef collection) {
             } // kHIDPage_Digitizer
         }
     }
+    TUCTrace(TUCTraceLevelDebug, TUCTraceEventTouchUpdated,
+             contactID, TUCTraceDouble(x), TUCTraceDouble(y), (tipSwitch ? 1 : 0) | (isValid ? 2 : 0));
+    
     TouchInputManagerUpdateTouchPosition(gTouchManager, contactID, x, y, (int)tipSwitch, (int)isValid);
     
 //    if (width != kCFNotFound && height != kCFNotFound && azimuth != kCFNotFound) {
@@ -404,12 +419,7 @@ void DispatchTouches(void) {
         numUpdates = remainingUpdates;
     }
     
-//    if(gTouchscreenUsesHybridMode && gHybridOffset > 0) {
-//        printf("Update NEXT %ld out of %ld touches beginning with %ld \n", numUpdates, gContactCount, gHybridOffset);
-//        
-//    } else {
-//        printf("Update %ld out of %ld touches beginning with %ld \n", numUpdates, gContactCount, gHybridOffset);
-//    }
+    TUCTrace(TUCTraceLevelVerbose, TUCTraceEventReportDispatched, numUpdates, gContactCount, gHybridOffset, 0);
     
     CFIndex numElementsToPost = CFArrayGetCount(gTouchCollectionElements);
     if (numUpdates < numElementsToPost)
@@ -418,8 +428,10 @@ void DispatchTouches(void) {
     // update the touch data
     for (CFIndex i=0; i<numElementsToPost; i++) {
         IOHIDElementRef collection = (IOHIDElementRef)CFArrayGetValueAtIndex(gTouchCollectionElements, i);
+        if (TUCTraceIsEnabled(TUCTraceLevelVerbose)) {
+            TraceTouchCollection(collection);
+        }
         DispatchTouchDataForCollection(collection);
-//        PrintTouchCollection(collection);
     }
     
     gHybridOffset = gHybridOffset + numUpdates;
@@ -439,6 +451,686 @@ void DispatchTouches(void) {
 
 
 
+#pragma mark - Decoding Raw Reports
+
+
+static uint32_t DevicePropertyNumber(IOHIDDeviceRef device, CFStringRef key) {
+    CFTypeRef property = IOHIDDeviceGetProperty(device, key);
+    uint32_t value = 0;
+    if (property && CFGetTypeID(property) == CFNumberGetTypeID()) {
+        CFNumberGetValue((CFNumberRef)property, kCFNumberSInt32Type, &value);
+    }
+    return value;
+}
+
+
+/**
+ Compiles the report descriptor of the device and picks a decoder for it. Returns FALSE if the elements have to be used instead.
+ */
+Boolean PrepareReportDecoder(IOHIDDeviceRef device) {
+    CFTypeRef descriptor = IOHIDDeviceGetProperty(device, CFSTR(kIOHIDReportDescriptorKey));
+    if (!descriptor || CFGetTypeID(descriptor) != CFDataGetTypeID()) {
+        return FALSE;
+    }
+    
+    const uint8_t *bytes = CFDataGetBytePtr(descriptor);
+    size_t length = (size_t)CFDataGetLength(descriptor);
+    
+    uint32_t vendorID  = DevicePropertyNumber(device, CFSTR(kIOHIDVendorIDKey));
+    uint32_t productID = DevicePropertyNumber(device, CFSTR(kIOHIDProductIDKey));
+    
+    // compiling takes a few microseconds, less than reading a cached layout from disk would
+    if (!HIDReportLayoutCompile(bytes, length, &gReportLayout)) {
+        return FALSE;
+    }
+    gReportLayout.vendorID  = vendorID;
+    gReportLayout.productID = productID;
+    gDevicePath = DevicePathCompiledLayout;
+    
+    gReportDecoder = HIDReportDecoderForLayout(&gReportLayout);
+    
+    TUCTrace(TUCTraceLevelInfo, TUCTraceEventDeviceLayout,
+             gReportLayout.vendorID, gReportLayout.productID, gReportLayout.descriptorHash, gReportLayout.numContacts);
+    TUCTrace(TUCTraceLevelInfo, TUCTraceEventDecoderSelected,
+             gReportDecoder.decode != HIDDecodeReportGeneric, gReportLayout.reportID, gReportLayout.reportSize, 0);
+    
+    gReportBufferSize = DevicePropertyNumber(device, CFSTR(kIOHIDMaxInputReportSizeKey));
+    if (gReportBufferSize < gReportLayout.reportSize) {
+        gReportBufferSize = gReportLayout.reportSize;
+    }
+    // the manager may have been closed and opened again without a removal callback for the previous device
+    free(gReportBuffer);
+    gReportBuffer = malloc(gReportBufferSize);
+    
+    return gReportBuffer != NULL;
+}
+
+
+/**
+ Same hybrid mode handling as `StoreInputValue` and `DispatchTouches`, but for a decoded report.
+ Returns true once all parts of the report were handed to the touch manager.
+ */
+static Boolean DispatchContactFrame(const HIDContactFrame *frame) {
+    CFIndex numCollections = frame->numContacts;
+    
+    TouchInputManagerSetReportTimestamp(gTouchManager, frame->timestamp);
+    
+    if (frame->contactCount < 0) {
+        gContactCount = numCollections;
+        gHybridOffset = 0;
+        
+    } else if (gContactCount > numCollections && frame->contactCount == 0 && gHybridOffset > 0) {
+        gTouchscreenUsesHybridMode = TRUE;
+        
+    } else {
+        gContactCount = frame->contactCount;
+        gHybridOffset = 0;
+    }
+    
+    CFIndex numUpdates = gContactCount - gHybridOffset;
+    if (numUpdates > numCollections) {
+        numUpdates = numCollections;
+    }
+    
+    TUCTrace(TUCTraceLevelVerbose, TUCTraceEventReportDispatched, numUpdates, gContactCount, gHybridOffset, 0);
+    
+    for (CFIndex i=0; i<numUpdates; i++) {
+        TUCTrace(TUCTraceLevelDebug, TUCTraceEventTouchUpdated,
+                 frame->contactID[i], TUCTraceDouble(frame->x[i]), TUCTraceDouble(frame->y[i]),
+                 frame->tipSwitch[i] | (frame->confidence[i] << 1));
+        
+        TouchInputManagerUpdateTouchPosition(gTouchManager, frame->contactID[i], frame->x[i], frame->y[i],
+                                             frame->tipSwitch[i] != 0, frame->confidence[i] != 0);
+    }
+    
+    gHybridOffset = gHybridOffset + numUpdates;
+    
+    if (gHybridOffset == gContactCount) {
+        gHybridOffset = 0;
+    }
+    
+    return gHybridOffset == 0;
+}
+
+
+
+
+
+#pragma mark - Device Bring-Up
+
+
+static uint64_t NanosecondsSince(uint64_t start) {
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return (mach_absolute_time() - start) * timebase.numer / timebase.denom;
+}
+
+
+static inline void NoteDispatchedEvent(void) {
+    if (!gHasDispatchedFirstEvent) {
+        gHasDispatchedFirstEvent = TRUE;
+        TUCTrace(TUCTraceLevelInfo, TUCTraceEventFirstEvent, gDevicePath, NanosecondsSince(gDeviceMatchTime), 0, 0);
+    }
+}
+
+
+static Boolean IsDescendantOfElement(IOHIDElementRef element, IOHIDElementRef ancestor) {
+    for (IOHIDElementRef parent = IOHIDElementGetParent(element); parent; parent = IOHIDElementGetParent(parent)) {
+        if (CFEqual(parent, ancestor)) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+
+/**
+ Finds the touch screen collection of the device and puts all its input elements into the queue before the first report arrives.
+ Without this, the elements are only discovered while the first values come in, and that report is lost.
+ */
+void PrepareElementQueue(IOHIDDeviceRef device, IOHIDQueueRef queue) {
+    CFArrayRef elements = IOHIDDeviceCopyMatchingElements(device, NULL, kIOHIDOptionsTypeNone);
+    if (!elements) {
+        return;
+    }
+    
+    CFIndex numElements = CFArrayGetCount(elements);
+    
+    for (CFIndex i=0; i<numElements && !gAreElementRefsSet; i++) {
+        IOHIDElementRef element = (IOHIDElementRef)CFArrayGetValueAtIndex(elements, i);
+        
+        if (   IOHIDElementGetType(element) == kIOHIDElementTypeCollection
+            && IOHIDElementGetCollectionType(element) == kIOHIDElementCollectionTypeApplication
+            && IOHIDElementGetUsagePage(element) == kHIDPage_Digitizer
+            && IOHIDElementGetUsage(element) == kHIDUsage_Dig_TouchScreen) {
+            
+            IdentifyElementsInApplicationCollection(element);
+            gAreElementRefsSet = 1;
+        }
+    }
+    
+    if (gAreElementRefsSet) {
+        for (CFIndex i=0; i<numElements; i++) {
+            IOHIDElementRef element = (IOHIDElementRef)CFArrayGetValueAtIndex(elements, i);
+            IOHIDElementType type = IOHIDElementGetType(element);
+            
+            if (type >= kIOHIDElementTypeInput_Misc && type <= kIOHIDElementTypeInput_ScanCodes
+                && IsDescendantOfElement(element, gApplicationCollectionElement)) {
+                IOHIDQueueAddElement(queue, element);
+            }
+        }
+    }
+    
+    CFRelease(elements);
+}
+
+
+
+
+
+#pragma mark - Device Configuration
+
+#define HID_MAX_FEATURE_REPORT_SIZE 512
+
+
+static Boolean ReadFeatureReport(IOHIDDeviceRef device, const HIDFeatureValue *value, uint8_t *report) {
+    CFIndex length = value->reportSize;
+    IOReturn result = IOHIDDeviceGetReport(device, kIOHIDReportTypeFeature, value->reportID, report, &length);
+    return result == kIOReturnSuccess && length >= value->reportSize;
+}
+
+
+/**
+ Returns -1 if the device has no such value or does not answer.
+ */
+static int32_t ReadFeatureValue(IOHIDDeviceRef device, const HIDFeatureValue *value) {
+    uint8_t report[HID_MAX_FEATURE_REPORT_SIZE];
+    if (!HIDFieldIsPresent(&value->field) || value->reportSize > sizeof(report) || !ReadFeatureReport(device, value, report)) {
+        return -1;
+    }
+    return HIDFieldRead(report, &value->field);
+}
+
+
+/**
+ The other values of the report keep their current state. If the report cannot be read, nothing is written: their state is
+ unknown and sending them as 0 could change other settings of the device. Every attempt is traced with its result.
+ */
+static IOReturn WriteFeatureValue(IOHIDDeviceRef device, const HIDFeatureValue *value, int32_t newValue) {
+    uint8_t report[HID_MAX_FEATURE_REPORT_SIZE];
+    if (!HIDFieldIsPresent(&value->field) || value->reportSize > sizeof(report)) {
+        return kIOReturnUnsupported;
+    }
+    
+    IOReturn result = kIOReturnNotReadable;
+    if (ReadFeatureReport(device, value, report)) {
+        HIDFieldWrite(report, &value->field, newValue);
+        result = IOHIDDeviceSetReport(device, kIOHIDReportTypeFeature, value->reportID, report, value->reportSize);
+    }
+    TUCTrace(TUCTraceLevelInfo, TUCTraceEventDeviceConfigured, value->usage, newValue, result, 0);
+    return result;
+}
+
+
+/**
+ Every feature report is a blocking round trip to the device, so they run on this queue and not on the main run loop.
+ */
+static dispatch_queue_t ConfigurationQueue(void) {
+    static dispatch_queue_t queue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        queue = dispatch_queue_create("TouchUpCore.configuration", DISPATCH_QUEUE_SERIAL);
+    });
+    return queue;
+}
+
+
+/**
+ Reads the configuration of the touchscreen and switches it to multi-input mode: in the other modes it reports
+ a single contact or none at all. Switching to normal latency changes the report rate, so it is left for later.
+ The matching callback returns before the device is asked.
+ */
+static void PrepareDeviceConfiguration(IOHIDDeviceRef device) {
+    atomic_store(&gHasPendingConfiguration, false);
+    uint32_t generation = atomic_fetch_add(&gConfigurationGeneration, 1) + 1;
+    
+    CFTypeRef descriptor = IOHIDDeviceGetProperty(device, CFSTR(kIOHIDReportDescriptorKey));
+    if (!descriptor || CFGetTypeID(descriptor) != CFDataGetTypeID()
+        || !HIDConfigurationLayoutCompile(CFDataGetBytePtr(descriptor), (size_t)CFDataGetLength(descriptor), &gConfigurationLayout)) {
+        memset(&gConfigurationLayout, 0, sizeof(HIDConfigurationLayout));
+        return;
+    }
+    
+    const HIDConfigurationLayout layout = gConfigurationLayout;
+    const int32_t contactsPerReport = gUsesReportDecoder ? gReportLayout.numContacts : -1;
+    
+    CFRetain(device);
+    dispatch_async(ConfigurationQueue(), ^{
+        int32_t inputMode    = ReadFeatureValue(device, &layout.inputMode);
+        int32_t latencyMode  = ReadFeatureValue(device, &layout.latencyMode);
+        int32_t contactCountMaximum = ReadFeatureValue(device, &layout.contactCountMaximum);
+        
+        TUCTrace(TUCTraceLevelInfo, TUCTraceEventDeviceSettings, inputMode, latencyMode, contactCountMaximum, contactsPerReport);
+        
+        // a report that cannot be read is not written, its other values are unknown
+        if (HIDFieldIsPresent(&layout.inputMode.field) && inputMode < 0) {
+            TUCTrace(TUCTraceLevelInfo, TUCTraceEventDeviceConfigured, layout.inputMode.usage, HID_INPUT_MODE_MULTI_INPUT,
+                     kIOReturnNotReadable, 0);
+        } else if (inputMode >= 0 && inputMode != HID_INPUT_MODE_MULTI_INPUT
+                   && atomic_load(&gConfigurationGeneration) == generation) {
+            WriteFeatureValue(device, &layout.inputMode, HID_INPUT_MODE_MULTI_INPUT);
+        }
+        
+        if (atomic_load(&gConfigurationGeneration) == generation) {
+            atomic_store(&gHasPendingConfiguration,
+                         HIDFieldIsPresent(&layout.latencyMode.field) && latencyMode != HID_LATENCY_MODE_NORMAL);
+        }
+        CFRelease(device);
+    });
+}
+
+
+/**
+ Called on removal, a configuration that is still on the way is dropped.
+ */
+static void CancelDeviceConfiguration(void) {
+    atomic_fetch_add(&gConfigurationGeneration, 1);
+    atomic_store(&gHasPendingConfiguration, false);
+}
+
+
+bool HIDApplyPendingConfiguration(void) {
+    if (!gDevice || !atomic_exchange(&gHasPendingConfiguration, false)) {
+        return false;
+    }
+    
+    IOHIDDeviceRef device = gDevice;
+    const HIDFeatureValue latencyMode = gConfigurationLayout.latencyMode;
+    const uint32_t generation = atomic_load(&gConfigurationGeneration);
+    
+    CFRetain(device);
+    dispatch_async(ConfigurationQueue(), ^{
+        // the device might have been removed while earlier feature reports were on the way
+        if (atomic_load(&gConfigurationGeneration) == generation) {
+            WriteFeatureValue(device, &latencyMode, HID_LATENCY_MODE_NORMAL);
+        }
+        CFRelease(device);
+    });
+    return true;
+}
+
+
+
+
+
+#pragma mark - Catching Up
+
+#define HID_BACKLOG_LAG_NS 20000000 // a report handled later than this after it was sent means ingestion is behind
+
+
+void HIDGetIngestionCounters(HIDIngestionCounters *counters) {
+    *counters = gIngestionCounters;
+}
+
+void HIDResetIngestionCounters(void) {
+    memset(&gIngestionCounters, 0, sizeof(HIDIngestionCounters));
+}
+
+
+static void ResetIngestionState(void) {
+    gHasPendingFrame = FALSE;
+    gQueuedReportHasTransition = FALSE;
+    gBacklogLength = 0;
+    gLastScanTime = -1;
+    gScanTimeInterval = 0;
+    gLastReportHadContacts = FALSE;
+    memset(gDispatchedContacts, 0, sizeof(gDispatchedContacts));
+}
+
+
+/**
+ Devices only send reports while contacts are down, and they step the scan time by the same interval each report.
+ A larger step between two reports with contacts means reports got lost on the way.
+ */
+static void CountDroppedReports(int32_t scanTime, int64_t scanTimeRange, Boolean hasContacts) {
+    if (scanTime < 0 || scanTimeRange <= 0) {
+        return;
+    }
+    
+    if (gLastScanTime >= 0 && gLastReportHadContacts && hasContacts) {
+        int32_t step = (int32_t)(((int64_t)scanTime - gLastScanTime + scanTimeRange) % scanTimeRange);
+        
+        // follow-up reports of hybrid mode repeat the scan time
+        if (step > 0) {
+            if (gScanTimeInterval == 0 || step < gScanTimeInterval) {
+                gScanTimeInterval = step;
+            }
+            int32_t missed = (step + gScanTimeInterval / 2) / gScanTimeInterval - 1;
+            if (missed > 0) {
+                gIngestionCounters.droppedReports += missed;
+            }
+        }
+    }
+    
+    gLastScanTime = scanTime;
+    gLastReportHadContacts = hasContacts;
+}
+
+
+static uint64_t NoteReportLag(uint64_t timestamp) {
+    gIngestionCounters.reports++;
+    
+    uint64_t lag = timestamp > 0 && timestamp < mach_absolute_time() ? NanosecondsSince(timestamp) : 0;
+    if (lag > gIngestionCounters.maxLagNs) {
+        gIngestionCounters.maxLagNs = lag;
+    }
+    return lag;
+}
+
+
+static void NoteDispatchedReport(Boolean isCaughtUp) {
+    gIngestionCounters.dispatchedReports++;
+    
+    if (gBacklogLength > 0 && isCaughtUp) {
+        if (gBacklogLength + 1 > gIngestionCounters.maxBacklog) {
+            gIngestionCounters.maxBacklog = gBacklogLength + 1;
+        }
+        TUCTrace(TUCTraceLevelInfo, TUCTraceEventBacklog, gBacklogLength, gIngestionCounters.mergedReports,
+                 gIngestionCounters.droppedReports, 0);
+        gBacklogLength = 0;
+    }
+    
+    NoteDispatchedEvent();
+}
+
+
+static Boolean IsPartOfHybridReport(CFIndex contactCount, CFIndex numCollections) {
+    return gTouchscreenUsesHybridMode || contactCount > numCollections || gHybridOffset > 0;
+}
+
+
+static void ContactSetOfFrame(const HIDContactFrame *frame, uint64_t set[4]) {
+    memset(set, 0, 4 * sizeof(uint64_t));
+    for (uint32_t i=0; i<frame->numContacts; i++) {
+        if (frame->tipSwitch[i]) {
+            uint32_t contactID = frame->contactID[i] & 0xFF;
+            set[contactID >> 6] |= 1ull << (contactID & 63);
+        }
+    }
+}
+
+
+static HIDFramePipeline *FramePipeline(void);
+static void RunFramePipeline(HIDFramePipeline *pipeline, HIDContactFrame *frame, uint32_t firstStage);
+
+
+static void FlushPendingFrame(void) {
+    gIsPendingFrameFlushScheduled = FALSE;
+    
+    if (gHasPendingFrame) {
+        gHasPendingFrame = FALSE;
+        ContactSetOfFrame(&gPendingFrame, gDispatchedContacts);
+        NoteDispatchedReport(TRUE);
+        
+        // the frame continues with the stage that followed ingest when it was held back, wherever that is now
+        HIDFramePipeline *pipeline = FramePipeline();
+        int32_t nextStage = HIDFramePipelineIndexOfStageID(pipeline, gPendingFrameNextStageID);
+        if (nextStage < 0) {
+            nextStage = HIDFramePipelineIndexOfStage(pipeline, HID_FRAME_STAGE_INGEST) + 1;
+        }
+        RunFramePipeline(pipeline, &gPendingFrame, (uint32_t)nextStage);
+    }
+}
+
+
+/**
+ Reports that queued up during a stall are delivered back to back. The flush runs once they are all handled,
+ so only the newest of them is dispatched.
+ */
+static void SchedulePendingFrameFlush(void) {
+    if (gIsPendingFrameFlushScheduled) {
+        return;
+    }
+    gIsPendingFrameFlushScheduled = TRUE;
+    
+    CFRunLoopPerformBlock(gRunLoopRef, kCFRunLoopCommonModes, ^{
+        FlushPendingFrame();
+    });
+    CFRunLoopWakeUp(gRunLoopRef);
+}
+
+
+/**
+ Ingest stage of the frame pipeline: a late frame that only moves contacts is held back and ends here.
+ */
+static bool IngestContactFrame(HIDContactFrame *frame, void *context) {
+    uint64_t lag = NoteReportLag(frame->timestamp);
+    
+    uint64_t contacts[4];
+    ContactSetOfFrame(frame, contacts);
+    Boolean isMotionOnly = memcmp(contacts, gDispatchedContacts, sizeof(contacts)) == 0;
+    
+    if (lag > HID_BACKLOG_LAG_NS && isMotionOnly && !IsPartOfHybridReport(frame->contactCount, frame->numContacts)) {
+        if (gHasPendingFrame) {
+            gIngestionCounters.mergedReports++;
+            gBacklogLength++;
+        }
+        gPendingFrame = *frame;
+        gPendingFrame.report = NULL;
+        gHasPendingFrame = TRUE;
+        
+        HIDFramePipeline *pipeline = FramePipeline();
+        int32_t nextStage = HIDFramePipelineIndexOfStage(pipeline, HID_FRAME_STAGE_INGEST) + 1;
+        gPendingFrameNextStageID = pipeline->stages[nextStage].stageID; // track follows ingest at the latest
+        SchedulePendingFrameFlush();
+        return false;
+    }
+    
+    if (gHasPendingFrame) {
+        // this report has the newer position of every contact
+        gIngestionCounters.mergedReports++;
+        gBacklogLength++;
+        gHasPendingFrame = FALSE;
+    }
+    memcpy(gDispatchedContacts, contacts, sizeof(contacts));
+    NoteDispatchedReport(lag <= HID_BACKLOG_LAG_NS);
+    return true;
+}
+
+
+/**
+ Called when all values of a report on the element path were stored. If the values of the next report are already waiting,
+ a report that only moved contacts is not dispatched: the next one overwrites its values anyway.
+ */
+void IngestQueuedReport(uint64_t timestamp, Boolean isNextReportWaiting) {
+    uint64_t lag = NoteReportLag(timestamp);
+    
+    if (gScanTimeElement) {
+        CountDroppedReports((int32_t)ValueOfElement(gScanTimeElement), IOHIDElementGetLogicalMax(gScanTimeElement) + 1,
+                            gContactCount > 0);
+    }
+    
+    CFIndex numCollections = CFArrayGetCount(gTouchCollectionElements);
+    
+    if (isNextReportWaiting && !gQueuedReportHasTransition && !IsPartOfHybridReport(gContactCount, numCollections)) {
+        gIngestionCounters.mergedReports++;
+        gBacklogLength++;
+        
+    } else {
+        TouchInputManagerSetReportTimestamp(gTouchManager, timestamp);
+        DispatchTouches();
+        NoteDispatchedReport(!isNextReportWaiting && lag <= HID_BACKLOG_LAG_NS);
+    }
+    
+    gQueuedReportHasTransition = FALSE;
+}
+
+
+
+#pragma mark - Frame Pipeline
+
+static bool DecodeContactFrame(HIDContactFrame *frame, void *context) {
+    return gReportDecoder.decode(&gReportLayout, frame->report, frame->reportLength, frame);
+}
+
+
+static bool CountDroppedFrames(HIDContactFrame *frame, void *context) {
+    Boolean hasContacts = FALSE;
+    for (uint32_t i=0; i<frame->numContacts; i++) {
+        hasContacts |= frame->tipSwitch[i] != 0;
+    }
+    CountDroppedReports(frame->scanTime, (int64_t)gReportLayout.scanTime.logicalMax + 1, hasContacts);
+    return true;
+}
+
+
+static bool TrackContactFrame(HIDContactFrame *frame, void *context) {
+    return DispatchContactFrame(frame);
+}
+
+
+static bool RecognizeGestures(HIDContactFrame *frame, void *context) {
+    TouchInputManagerRecognizeGestures(gTouchManager);
+    return true;
+}
+
+
+static bool PublishContactFrame(HIDContactFrame *frame, void *context) {
+    TouchInputManagerPublishFrame(gTouchManager);
+    return true;
+}
+
+
+static void InsertBuiltInStage(HIDFramePipeline *pipeline, const char *name, HIDFrameStageFunction process) {
+    HIDFramePipelineInsert(pipeline, name, process, NULL, NULL);
+    pipeline->stages[pipeline->numStages - 1].isBuiltIn = true;
+}
+
+
+/**
+ decode -> scan time -> ingest -> track -> gestures -> publish. The last three are the steps of the touch manager.
+ Set up on first use, so custom stages can be added before the manager opens. Call with the lock held.
+ */
+static HIDFramePipeline *StagedFramePipeline(void) {
+    if (!gIsFramePipelineReady) {
+        HIDFramePipelineInit(&gStagedFramePipeline);
+        InsertBuiltInStage(&gStagedFramePipeline, HID_FRAME_STAGE_DECODE,    DecodeContactFrame);
+        InsertBuiltInStage(&gStagedFramePipeline, HID_FRAME_STAGE_SCAN_TIME, CountDroppedFrames);
+        InsertBuiltInStage(&gStagedFramePipeline, HID_FRAME_STAGE_INGEST,    IngestContactFrame);
+        InsertBuiltInStage(&gStagedFramePipeline, HID_FRAME_STAGE_TRACK,     TrackContactFrame);
+        InsertBuiltInStage(&gStagedFramePipeline, HID_FRAME_STAGE_GESTURES,  RecognizeGestures);
+        InsertBuiltInStage(&gStagedFramePipeline, HID_FRAME_STAGE_PUBLISH,   PublishContactFrame);
+        gIsFramePipelineReady = TRUE;
+    }
+    return &gStagedFramePipeline;
+}
+
+
+/**
+ The stages must not change while a frame passes them, so changes made from within a stage wait for the next frame.
+ */
+static Boolean gIsFramePipelineRunning;
+
+/**
+ The pipeline frames pass, on the run loop only. Takes over the staged stages if they changed since the last frame.
+ */
+static HIDFramePipeline *FramePipeline(void) {
+    if (gIsFramePipelineRunning) {
+        return &gFramePipeline;
+    }
+    
+    if (atomic_exchange(&gShouldResetFrameStageTimings, false)) {
+        HIDFramePipelineResetTimings(&gFramePipeline);
+    }
+    
+    uint32_t generation = atomic_load(&gStagedFramePipelineGeneration);
+    if (generation != gFramePipelineGeneration) {
+        HIDFramePipeline previous = gFramePipeline;
+        
+        os_unfair_lock_lock(&gStagedFramePipelineLock);
+        gFramePipeline = *StagedFramePipeline();
+        gFramePipelineGeneration = atomic_load(&gStagedFramePipelineGeneration);
+        os_unfair_lock_unlock(&gStagedFramePipelineLock);
+        
+        HIDFramePipelineCopyTimings(&gFramePipeline, &previous);
+    }
+    return &gFramePipeline;
+}
+
+
+static void RunFramePipeline(HIDFramePipeline *pipeline, HIDContactFrame *frame, uint32_t firstStage) {
+    // nobody reads the timings without a trace, so the stages run without touching the clock
+    pipeline->measuresTimings = TUCTraceIsEnabled(TUCTraceLevelInfo);
+    
+    gIsFramePipelineRunning = TRUE;
+    HIDFramePipelineRun(pipeline, frame, firstStage);
+    gIsFramePipelineRunning = FALSE;
+    
+    // a reader holding the lock only delays the copy to the next frame, a pending reset drops it
+    if (pipeline->measuresTimings && !atomic_load(&gShouldResetFrameStageTimings)
+        && os_unfair_lock_trylock(&gStagedFramePipelineLock)) {
+        HIDFramePipelineCopyTimings(&gStagedFramePipeline, pipeline);
+        os_unfair_lock_unlock(&gStagedFramePipelineLock);
+    }
+}
+
+
+/**
+ Changes the staged pipeline from any thread, the run loop picks the change up before its next frame. Returns what `change` returned.
+ */
+static bool ChangeFramePipeline(bool (^change)(HIDFramePipeline *pipeline)) {
+    os_unfair_lock_lock(&gStagedFramePipelineLock);
+    bool isChanged = change(StagedFramePipeline());
+    if (isChanged) {
+        atomic_fetch_add(&gStagedFramePipelineGeneration, 1);
+    }
+    os_unfair_lock_unlock(&gStagedFramePipelineLock);
+    return isChanged;
+}
+
+
+/**
+ Per device: without a scan time there are no dropped reports to count.
+ */
+static void ConfigureFramePipeline(void) {
+    bool hasScanTime = HIDFieldIsPresent(&gReportLayout.scanTime);
+    ChangeFramePipeline(^bool(HIDFramePipeline *pipeline) {
+        HIDFramePipelineSetStageEnabled(pipeline, HID_FRAME_STAGE_SCAN_TIME, hasScanTime);
+        return true;
+    });
+}
+
+
+bool HIDInsertFrameStage(const char *name, HIDFrameStageFunction process, void *context, const char *nextStage) {
+    return ChangeFramePipeline(^bool(HIDFramePipeline *pipeline) {
+        return HIDFramePipelineInsert(pipeline, name, process, context, nextStage);
+    });
+}
+
+bool HIDRemoveFrameStage(const char *name) {
+    return ChangeFramePipeline(^bool(HIDFramePipeline *pipeline) {
+        return HIDFramePipelineRemove(pipeline, name);
+    });
+}
+
+void HIDCopyFramePipeline(HIDFramePipeline *pipeline) {
+    os_unfair_lock_lock(&gStagedFramePipelineLock);
+    *pipeline = *StagedFramePipeline();
+    os_unfair_lock_unlock(&gStagedFramePipelineLock);
+}
+
+void HIDResetFrameStageTimings(void) {
+    atomic_store(&gShouldResetFrameStageTimings, true);
+    
+    os_unfair_lock_lock(&gStagedFramePipelineLock);
+    HIDFramePipelineResetTimings(StagedFramePipeline());
+    os_unfair_lock_unlock(&gStagedFramePipelineLock);
+}
+
+
+
 #pragma mark - Callbacks
 
 /*!
@@ -453,14 +1145,29 @@ static void Handle_QueueValueAvailable(
             void * _Nullable        inSender
 ) {
     
+    uint64_t reportTimestamp = 0;
+    Boolean hasReport = FALSE;
+    
     do {
         IOHIDValueRef valueRef = IOHIDQueueCopyNextValueWithTimeout((IOHIDQueueRef) inSender, 0.);
+        uint64_t timestamp = valueRef ? IOHIDValueGetTimeStamp(valueRef) : 0;
+        
+        // all values of a report share its timestamp: a new one, or an empty queue, completes the report
+        if (hasReport && (!valueRef || timestamp != reportTimestamp)) {
+            IngestQueuedReport(reportTimestamp, valueRef != NULL);
+            hasReport = FALSE;
+        }
+        
         if (!valueRef)  {
-            // finished processing 1 report
-            DispatchTouches();
             break;
         }
+        hasReport = TRUE;
+        reportTimestamp = timestamp;
+        
         // process the HID value reference
+        if (TUCTraceIsEnabled(TUCTraceLevelVerbose)) {
+            TraceInput(valueRef);
+        }
         StoreInputValue(valueRef);
         
         // Don't forget to release our HID value reference
@@ -469,15 +1176,43 @@ static void Handle_QueueValueAvailable(
 }
 
 
+static void Handle_InputReport(
+            void *                  context,
+            IOReturn                result,
+            void *                  sender,
+            IOHIDReportType         type,
+            uint32_t                reportID,
+            uint8_t *               report,
+            CFIndex                 reportLength,
+            uint64_t                timeStamp
+) {
+    if (type != kIOHIDReportTypeInput || reportID != gReportLayout.reportID) {
+        return;
+    }
+    
+    gContactFrame.timestamp    = timeStamp;
+    gContactFrame.report       = report;
+    gContactFrame.reportLength = (uint32_t)reportLength;
+    
+    RunFramePipeline(FramePipeline(), &gContactFrame, 0);
+    
+    gContactFrame.report = NULL;
+}
+
+
 static void Handle_InputValueCallback (
                 void *          inContext,      // context from IOHIDManagerRegisterInputValueCallback
                 IOReturn        inResult,       // completion result for the input value operation
                 void *          inSender,       // the IOHIDManagerRef
                 IOHIDValueRef   inIOHIDValueRef // the new element value
 ) {
+    if (gUsesReportDecoder) {
+        return;
+    }
+    
     if(!gAreElementRefsSet) {
         IOHIDElementRef e = IOHIDValueGetElement(inIOHIDValueRef);
-        IdentifyElements(e, TRUE);
+        IdentifyElements(e);
         gAreElementRefsSet = 1;
     }
     
@@ -498,6 +1233,17 @@ static void Handle_InputValueCallback (
 
 
 
+/**
+ The manager calls this for every single value of every report, which keeps the process busy even if nobody needs the values.
+ It is only registered while a device is decoded via its elements and they could not be discovered when it was matched.
+ */
+static void UpdateInputValueCallback(void) {
+    Boolean needsValues = gDevice != NULL && !gUsesReportDecoder && !gAreElementRefsSet;
+    IOHIDManagerRegisterInputValueCallback(gHidManager, needsValues ? Handle_InputValueCallback : NULL, NULL);
+}
+
+
+
 // this will be called when the HID Manager matches a new (hot plugged) HID device
 static void Handle_DeviceMatchingCallback(
             void *          inContext,       // context from IOHIDManagerRegisterDeviceMatchingCallback
@@ -505,10 +1251,33 @@ static void Handle_DeviceMatchingCallback(
             void *          inSender,        // the IOHIDManagerRef for the new device
             IOHIDDeviceRef  inIOHIDDeviceRef // the new HID device
 ) {
-    printf("%s(context: %p, result: %p, sender: %p, device: %p).\n",
-        __PRETTY_FUNCTION__, inContext, (void *) inResult, inSender, (void*) inIOHIDDeviceRef);
+    TUCTrace(TUCTraceLevelInfo, TUCTraceEventDeviceMatched, (uintptr_t)inIOHIDDeviceRef, inResult, 0, 0);
    
+    gDeviceMatchTime = mach_absolute_time();
+    gHasDispatchedFirstEvent = FALSE;
     gAreElementRefsSet = 0;
+    gDevice = inIOHIDDeviceRef;
+    ResetIngestionState();
+    
+    // hybrid mode is a property of the device, the next one has to show it again
+    gTouchscreenUsesHybridMode = FALSE;
+    gContactCount = 1;
+    gHybridOffset = 0;
+    
+    gUsesReportDecoder = PrepareReportDecoder(inIOHIDDeviceRef);
+    PrepareDeviceConfiguration(inIOHIDDeviceRef);
+    
+    if (gUsesReportDecoder) {
+        ConfigureFramePipeline();
+        IOHIDDeviceRegisterInputReportWithTimeStampCallback(inIOHIDDeviceRef, gReportBuffer, gReportBufferSize,
+                                                            Handle_InputReport, NULL);
+        UpdateInputValueCallback();
+        TouchInputManagerDidConnectTouchscreen(gTouchManager);
+        TUCTrace(TUCTraceLevelInfo, TUCTraceEventDeviceReady, gDevicePath, NanosecondsSince(gDeviceMatchTime), 0, 0);
+        return;
+    }
+    
+    gDevicePath = DevicePathElements;
     
     
     IOHIDQueueRef queue = IOHIDQueueCreate(kCFAllocatorDefault, inIOHIDDeviceRef, 1000, kNilOptions);
@@ -517,13 +1286,17 @@ static void Handle_DeviceMatchingCallback(
         // this is not a valid HID queue reference!
     }
     
+    PrepareElementQueue(inIOHIDDeviceRef, queue);
+    
     IOHIDQueueRegisterValueAvailableCallback(queue, Handle_QueueValueAvailable, NULL);
     IOHIDQueueStart(queue);
     gQueue = queue;
     
     IOHIDQueueScheduleWithRunLoop(queue, gRunLoopRef, kCFRunLoopCommonModes);
     
+    UpdateInputValueCallback();
     TouchInputManagerDidConnectTouchscreen(gTouchManager);
+    TUCTrace(TUCTraceLevelInfo, TUCTraceEventDeviceReady, gDevicePath, NanosecondsSince(gDeviceMatchTime), 0, 0);
     
 }   // Handle_DeviceMatchingCallback
  
@@ -536,11 +1309,26 @@ static void Handle_RemovalCallback(
                 void *         inSender,        // the IOHIDManagerRef for the device being removed
                 IOHIDDeviceRef inIOHIDDeviceRef // the removed HID device
 ) {
-    printf("%s(context: %p, result: %p, sender: %p, device: %p).\n",
-        __PRETTY_FUNCTION__, inContext, (void *) inResult, inSender, (void*) inIOHIDDeviceRef);
-    IOHIDQueueStop(gQueue);
-    CFRelease(gQueue);
-    gQueue = NULL;
+    TUCTrace(TUCTraceLevelInfo, TUCTraceEventDeviceRemoved, (uintptr_t)inIOHIDDeviceRef, inResult, 0, 0);
+    
+    if (gUsesReportDecoder) {
+        IOHIDDeviceRegisterInputReportWithTimeStampCallback(inIOHIDDeviceRef, gReportBuffer, gReportBufferSize, NULL, NULL);
+        free(gReportBuffer);
+        gReportBuffer = NULL;
+        gUsesReportDecoder = FALSE;
+    }
+    
+    if (gQueue) {
+        IOHIDQueueStop(gQueue);
+        CFRelease(gQueue);
+        gQueue = NULL;
+    }
+    gDevice = NULL;
+    CancelDeviceConfiguration();
+    UpdateInputValueCallback();
+    
+    // a scheduled flush must not deliver a frame of the removed device
+    ResetIngestionState();
     
     CFArrayRemoveAllValues(gTouchCollectionElements);
     CFArrayRemoveAllValues(gContactIdentifiers);
@@ -602,7 +1390,7 @@ void OpenHIDManager(void *delegate) {
     gHidManager = IOHIDManagerCreate(kCFAllocatorDefault, kIOHIDOptionsTypeNone);
     
     if (CFGetTypeID(gHidManager) != IOHIDManagerGetTypeID()) {
-        printf("OH CRAP THIS IS NOT AN HID MANAGER");
+        TUCTrace(TUCTraceLevelError, TUCTraceEventHIDManagerError, 0, 0, 0, 0);
     }
         
     
@@ -610,11 +1398,7 @@ void OpenHIDManager(void *delegate) {
     gContactIdentifiers      = CFArrayCreateMutable(kCFAllocatorDefault, 0, NULL);
     gStoredInputValues       = CFDictionaryCreateMutable(kCFAllocatorDefault,0, NULL, NULL);
    
-//    CFMutableDictionaryRef keyboard =
-//    CreateDeviceMatchingDictionary(kHIDPage_Digitizer, kHIDUsage_Dig_Pen);
-//    CFMutableDictionaryRef keypad =
-//    CreateDeviceMatchingDictionary(kHIDPage_Digitizer, kHIDUsage_Dig_Touch);
-
+    // pens are matched by their own manager, see HIDPenInterpreter.h
     CFMutableDictionaryRef matchesList[] = {
         CreateDeviceMatchingDictionary(kHIDPage_Digitizer, kHIDUsage_Dig_TouchScreen),
     };
@@ -639,11 +1423,15 @@ void OpenHIDManager(void *delegate) {
                                     kCFRunLoopCommonModes);
 
     IOHIDManagerOpen(gHidManager, kIOHIDOptionsTypeNone);
+    
+    OpenPenHIDManager(delegate);
 }
 
 
 
 void CloseHIDManager(void) {
+    ClosePenHIDManager();
+    
     IOHIDManagerUnscheduleFromRunLoop(gHidManager, gRunLoopRef, kCFRunLoopCommonModes);
     IOHIDManagerClose(gHidManager, kIOHIDOptionsTypeNone);
 }
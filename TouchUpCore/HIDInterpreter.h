@@ -9,9 +9,55 @@
 #define HIDInterpreter_h
 
 #include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "HIDFramePipeline.h"
 
 void OpenHIDManager(void *delegate);
 
 void CloseHIDManager(void);
 
+
+/**
+ Counts how touch reports were ingested. After a stall of the main thread, reports that only move contacts are merged into
+ the newest one instead of being replayed, reports that begin or end a contact are always dispatched.
+ */
+typedef struct {
+    uint64_t reports;
+    uint64_t dispatchedReports;
+    uint64_t mergedReports;     // folded into a newer report because ingestion was behind
+    uint64_t droppedReports;    // missing according to the scan time, lost before they reached us
+    uint64_t maxBacklog;        // most reports behind at once
+    uint64_t maxLagNs;          // largest delay between the timestamp of a report and its handling
+} HIDIngestionCounters;
+
+void HIDGetIngestionCounters(HIDIngestionCounters *counters);
+
+void HIDResetIngestionCounters(void);
+
+
+/**
+ When a touchscreen connects, it is switched to multi-input mode via its feature reports, if it has them.
+ If it also is in its high latency mode, the switch to normal latency waits for this call, so the report rate can be measured
+ in both modes. The feature reports are sent from a background queue. Returns true if the switch was started.
+ */
+bool HIDApplyPendingConfiguration(void);
+
+
+/**
+ Custom stages for the frame pipeline, see `HIDFramePipelineInsert`. Frames held back by the ingest stage continue after it,
+ so filters that have to see every report belong in front of it. The stages stay installed when the touchscreen changes.
+ Safe to call from any thread, also from within a stage: the call returns right away with the outcome, and the run loop
+ starts using the changed pipeline with its next frame.
+ */
+bool HIDInsertFrameStage(const char *name, HIDFrameStageFunction process, void *context, const char *nextStage);
+bool HIDRemoveFrameStage(const char *name);
+
+/**
+ Copies the stages with their timings. Timings are only measured while a trace of level info or higher runs.
+ */
+void HIDCopyFramePipeline(HIDFramePipeline *pipeline);
+void HIDResetFrameStageTimings(void);
+
 #endif /* HIDInterpreter_h */
@@ -0,0 +1,270 @@
+//
+//  HIDPenInterpreter.c
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "HIDPenInterpreter.h"
+#include "TUCTouchInputManager-C.h"
+#include "TUCTrace.h"
+#include "HIDReportLayout.h"
+#include "HIDReportDecoder.h"
+
+#include <IOKit/IOKitLib.h>
+#include <IOKit/hid/IOHIDManager.h>
+#include <dispatch/dispatch.h>
+#include <pthread.h>
+
+#include <stdlib.h>
+
+#pragma mark - Global variables
+
+static void* gPenTouchManager;
+
+static CFRunLoopRef gPenRunLoopRef;
+
+static IOHIDManagerRef gPenHidManager;
+
+static dispatch_semaphore_t gPenThreadReady;
+static dispatch_semaphore_t gPenThreadStopped;
+
+
+/**
+ Only one pen is handled at a time, like only one touchscreen.
+ */
+IOHIDDeviceRef          gPenDevice;
+HIDPenLayout            gPenLayout;
+HIDPenSample            gPenSample;
+uint8_t                *gPenReportBuffer;
+CFIndex                 gPenReportBufferSize;
+
+
+
+#pragma mark - Decoding
+
+static uint32_t PenDevicePropertyNumber(IOHIDDeviceRef device, CFStringRef key) {
+    CFTypeRef property = IOHIDDeviceGetProperty(device, key);
+    uint32_t value = 0;
+    if (property && CFGetTypeID(property) == CFNumberGetTypeID()) {
+        CFNumberGetValue((CFNumberRef)property, kCFNumberSInt32Type, &value);
+    }
+    return value;
+}
+
+
+static Boolean PreparePenDecoder(IOHIDDeviceRef device) {
+    CFTypeRef descriptor = IOHIDDeviceGetProperty(device, CFSTR(kIOHIDReportDescriptorKey));
+    if (!descriptor || CFGetTypeID(descriptor) != CFDataGetTypeID()) {
+        return FALSE;
+    }
+    
+    if (!HIDPenLayoutCompile(CFDataGetBytePtr(descriptor), (size_t)CFDataGetLength(descriptor), &gPenLayout)) {
+        return FALSE;
+    }
+    
+    TUCTrace(TUCTraceLevelInfo, TUCTraceEventPenLayout, gPenLayout.reportID, gPenLayout.reportSize,
+             HIDFieldIsPresent(&gPenLayout.tipPressure), HIDFieldIsPresent(&gPenLayout.xTilt));
+    
+    gPenReportBufferSize = PenDevicePropertyNumber(device, CFSTR(kIOHIDMaxInputReportSizeKey));
+    if (gPenReportBufferSize < gPenLayout.reportSize) {
+        gPenReportBufferSize = gPenLayout.reportSize;
+    }
+    gPenReportBuffer = malloc(gPenReportBufferSize);
+    
+    return gPenReportBuffer != NULL;
+}
+
+
+static void DispatchPenSample(const HIDPenSample *sample) {
+    TUCTrace(TUCTraceLevelVerbose, TUCTraceEventPenSample,
+             TUCTraceDouble(sample->x), TUCTraceDouble(sample->y), TUCTraceDouble(sample->pressure),
+             sample->inRange | (sample->tipSwitch << 1) | (sample->barrelSwitch << 2) | (sample->eraser << 3));
+    
+    TouchInputManagerUpdatePen(gPenTouchManager, sample->x, sample->y, sample->pressure, sample->tiltX, sample->tiltY,
+                               sample->inRange, sample->tipSwitch, sample->barrelSwitch, sample->eraser);
+}
+
+
+
+#pragma mark - Callbacks
+
+static void Handle_PenInputReport(
+            void *                  context,
+            IOReturn                result,
+            void *                  sender,
+            IOHIDReportType         type,
+            uint32_t                reportID,
+            uint8_t *               report,
+            CFIndex                 reportLength,
+            uint64_t                timeStamp
+) {
+    if (type != kIOHIDReportTypeInput || reportID != gPenLayout.reportID) {
+        return;
+    }
+    
+    // every report is passed on, hover moves are not coalesced
+    if (HIDDecodePenReport(&gPenLayout, report, reportLength, &gPenSample)) {
+        gPenSample.timestamp = timeStamp;
+        DispatchPenSample(&gPenSample);
+    }
+}
+
+
+static void Handle_PenDeviceMatchingCallback(
+            void *          inContext,
+            IOReturn        inResult,
+            void *          inSender,
+            IOHIDDeviceRef  inIOHIDDeviceRef
+) {
+    TUCTrace(TUCTraceLevelInfo, TUCTraceEventDeviceMatched, (uintptr_t)inIOHIDDeviceRef, inResult, 0, 0);
+    
+    if (gPenDevice != NULL || !PreparePenDecoder(inIOHIDDeviceRef)) {
+        return;
+    }
+    
+    gPenDevice = inIOHIDDeviceRef;
+    IOHIDDeviceRegisterInputReportWithTimeStampCallback(inIOHIDDeviceRef, gPenReportBuffer, gPenReportBufferSize,
+                                                        Handle_PenInputReport, NULL);
+}
+
+
+/**
+ Forgets the pen, so the next one can be matched. A pressed tip is released and the pen leaves proximity.
+ */
+static void ReleasePenDevice(void) {
+    if (gPenDevice == NULL) {
+        return;
+    }
+    
+    IOHIDDeviceRegisterInputReportWithTimeStampCallback(gPenDevice, gPenReportBuffer, gPenReportBufferSize, NULL, NULL);
+    free(gPenReportBuffer);
+    gPenReportBuffer = NULL;
+    gPenDevice = NULL;
+    
+    if (gPenSample.inRange) {
+        gPenSample.inRange = 0;
+        gPenSample.tipSwitch = 0;
+        gPenSample.barrelSwitch = 0;
+        gPenSample.pressure = 0;
+        DispatchPenSample(&gPenSample);
+    }
+}
+
+
+static void Handle_PenRemovalCallback(
+            void *         inContext,
+            IOReturn       inResult,
+            void *         inSender,
+            IOHIDDeviceRef inIOHIDDeviceRef
+) {
+    if (inIOHIDDeviceRef != gPenDevice) {
+        return;
+    }
+    
+    TUCTrace(TUCTraceLevelInfo, TUCTraceEventDeviceRemoved, (uintptr_t)inIOHIDDeviceRef, inResult, 0, 0);
+    ReleasePenDevice();
+}
+
+
+
+#pragma mark - Start / Stop
+
+static CFMutableDictionaryRef CreatePenMatchingDictionary(void) {
+    CFMutableDictionaryRef result = CFDictionaryCreateMutable(
+        kCFAllocatorDefault, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    
+    // the device usage keys are matched against all usage pairs, so touchscreens with a pen collection match as well
+    UInt32 usagePage = kHIDPage_Digitizer;
+    UInt32 usage     = kHIDUsage_Dig_Pen;
+    CFNumberRef pageNumber  = CFNumberCreate(kCFAllocatorDefault, kCFNumberIntType, &usagePage);
+    CFNumberRef usageNumber = CFNumberCreate(kCFAllocatorDefault, kCFNumberIntType, &usage);
+    
+    CFDictionarySetValue(result, CFSTR(kIOHIDDeviceUsagePageKey), pageNumber);
+    CFDictionarySetValue(result, CFSTR(kIOHIDDeviceUsageKey), usageNumber);
+    
+    CFRelease(pageNumber);
+    CFRelease(usageNumber);
+    return result;
+}
+
+
+static void *PenThreadMain(void *argument) {
+    pthread_setname_np("TouchUp Pen");
+    
+    gPenRunLoopRef = CFRunLoopGetCurrent();
+    
+    gPenHidManager = IOHIDManagerCreate(kCFAllocatorDefault, kIOHIDOptionsTypeNone);
+    
+    if (CFGetTypeID(gPenHidManager) != IOHIDManagerGetTypeID()) {
+        TUCTrace(TUCTraceLevelError, TUCTraceEventHIDManagerError, 1, 0, 0, 0);
+    }
+    
+    CFMutableDictionaryRef matching = CreatePenMatchingDictionary();
+    IOHIDManagerSetDeviceMatching(gPenHidManager, matching);
+    CFRelease(matching);
+    
+    IOHIDManagerRegisterDeviceMatchingCallback(gPenHidManager, Handle_PenDeviceMatchingCallback, NULL);
+    IOHIDManagerRegisterDeviceRemovalCallback(gPenHidManager, Handle_PenRemovalCallback, NULL);
+    
+    IOHIDManagerScheduleWithRunLoop(gPenHidManager, gPenRunLoopRef, kCFRunLoopDefaultMode);
+    IOHIDManagerOpen(gPenHidManager, kIOHIDOptionsTypeNone);
+    
+    dispatch_semaphore_signal(gPenThreadReady);
+    
+    CFRunLoopRun();
+    
+    dispatch_semaphore_signal(gPenThreadStopped);
+    return NULL;
+}
+
+
+void OpenPenHIDManager(void *delegate) {
+    if (gPenRunLoopRef) {
+        return;
+    }
+    
+    gPenTouchManager = delegate;
+    if (!gPenThreadReady) {
+        gPenThreadReady   = dispatch_semaphore_create(0);
+        gPenThreadStopped = dispatch_semaphore_create(0);
+    }
+    
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_set_qos_class_np(&attributes, QOS_CLASS_USER_INTERACTIVE, 0);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    
+    pthread_t thread;
+    if (pthread_create(&thread, &attributes, PenThreadMain, NULL) == 0) {
+        dispatch_semaphore_wait(gPenThreadReady, DISPATCH_TIME_FOREVER);
+    }
+    pthread_attr_destroy(&attributes);
+}
+
+
+void ClosePenHIDManager(void) {
+    if (!gPenRunLoopRef) {
+        return;
+    }
+    
+    // the pen globals belong to the pen thread, it tears them down itself between two reports
+    CFRunLoopRef runLoop = gPenRunLoopRef;
+    CFRunLoopPerformBlock(runLoop, kCFRunLoopDefaultMode, ^{
+        ReleasePenDevice();
+        
+        IOHIDManagerRegisterDeviceMatchingCallback(gPenHidManager, NULL, NULL);
+        IOHIDManagerRegisterDeviceRemovalCallback(gPenHidManager, NULL, NULL);
+        IOHIDManagerUnscheduleFromRunLoop(gPenHidManager, runLoop, kCFRunLoopDefaultMode);
+        IOHIDManagerClose(gPenHidManager, kIOHIDOptionsTypeNone);
+        CFRelease(gPenHidManager);
+        gPenHidManager = NULL;
+        
+        CFRunLoopStop(runLoop);
+    });
+    CFRunLoopWakeUp(runLoop);
+    
+    // the pen thread only posts to the main thread asynchronously, so waiting for it here cannot deadlock
+    dispatch_semaphore_wait(gPenThreadStopped, DISPATCH_TIME_FOREVER);
+    gPenRunLoopRef = NULL;
+}
@@ -0,0 +1,24 @@
+//
+//  HIDPenInterpreter.h
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef HIDPenInterpreter_h
+#define HIDPenInterpreter_h
+
+#include <stdio.h>
+
+/**
+ Pens are handled by their own HID manager on their own thread: pen digitizers and touchscreens with a pen collection report at 200 Hz
+ and more while the pen hovers, and none of these reports should wait for, or delay, a touch report on the main thread.
+ */
+void OpenPenHIDManager(void *delegate);
+
+/**
+ Releases the pen and its HID manager on the pen thread and waits until the thread ended. The manager can be opened again afterwards.
+ */
+void ClosePenHIDManager(void);
+
+#endif /* HIDPenInterpreter_h */
@@ -0,0 +1,214 @@
+//
+//  HIDReportDecoder.c
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "HIDReportDecoder.h"
+#include "HIDContactKernels.h"
+
+#pragma mark - Generic Decoder
+
+static inline void DecodeReportHeader(const HIDReportLayout *layout, const uint8_t *report, HIDContactFrame *frame) {
+    frame->contactCount = HIDFieldIsPresent(&layout->contactCount) ? HIDFieldRead(report, &layout->contactCount) : -1;
+    frame->scanTime     = HIDFieldIsPresent(&layout->scanTime)     ? HIDFieldRead(report, &layout->scanTime)     : -1;
+    frame->numContacts  = layout->numContacts;
+}
+
+
+bool HIDDecodeReportGeneric(const HIDReportLayout *layout, const uint8_t *report, size_t length, HIDContactFrame *frame) {
+    if (length < layout->reportSize) {
+        return false;
+    }
+
+    DecodeReportHeader(layout, report, frame);
+    HIDUnpackContacts(layout, report, length, frame);
+    HIDNormalizeContacts(layout, frame);
+    return true;
+}
+
+
+bool HIDDecodeReportReference(const HIDReportLayout *layout, const uint8_t *report, size_t length, HIDContactFrame *frame) {
+    if (length < layout->reportSize) {
+        return false;
+    }
+
+    DecodeReportHeader(layout, report, frame);
+    HIDUnpackContactsReference(layout, report, frame);
+    HIDNormalizeContactsReference(layout, frame);
+    return true;
+}
+
+
+
+#pragma mark - Specialized Decoders
+
+/**
+ Most Windows-certified panels describe every finger with the same block, directly after the report ID:
+   byte 0       bit 0 tip switch, bit 1 confidence, rest padding
+   byte 1       contact ID
+   bytes 2-3    X, unsigned
+   bytes 4-5    Y, unsigned
+ optionally followed by more values (width, height, ...) up to the stride.
+ Contact count and scan time are read through the layout, they are only two values per report. Coordinates are normalized with
+ the vector kernel, so the logical ranges may differ between contacts.
+ */
+
+#define HID_FIXED_FIRST_BYTE 1
+
+static inline __attribute__((always_inline))
+void DecodeFixedContacts(const HIDReportLayout *layout, const uint8_t *report, const uint32_t numContacts, const uint32_t stride, HIDContactFrame *frame) {
+#pragma clang loop unroll(full)
+    for (uint32_t i=0; i<numContacts; i++) {
+        const uint8_t *block = report + HID_FIXED_FIRST_BYTE + i * stride;
+
+        frame->tipSwitch[i]  = block[0] & 0x1;
+        frame->confidence[i] = (block[0] >> 1) & 0x1;
+        frame->contactID[i]  = block[1];
+        frame->rawX[i]       = (uint16_t)(block[2] | (block[3] << 8));
+        frame->rawY[i]       = (uint16_t)(block[4] | (block[5] << 8));
+    }
+
+    HIDNormalizeContacts(layout, frame);
+}
+
+
+// (contacts per report, bytes per contact)
+#define HID_FIXED_SHAPES(X) \
+    X(1,  6)  \
+    X(2,  6)  \
+    X(5,  6)  \
+    X(10, 6)  \
+    X(2,  10) \
+    X(5,  10) \
+    X(10, 10)
+
+#define HID_FIXED_DECODER_NAME(contacts, stride) HIDDecodeReportFixed_##contacts##x##stride
+
+#define HID_DEFINE_FIXED_DECODER(contacts, stride)                                                          \
+static bool HID_FIXED_DECODER_NAME(contacts, stride)(const HIDReportLayout *layout, const uint8_t *report,   \
+                                                     size_t length, HIDContactFrame *frame) {                \
+    if (length < layout->reportSize) {                                                                       \
+        return false;                                                                                        \
+    }                                                                                                        \
+    DecodeReportHeader(layout, report, frame);                                                               \
+    DecodeFixedContacts(layout, report, contacts, stride, frame);                                            \
+    return true;                                                                                             \
+}
+
+HID_FIXED_SHAPES(HID_DEFINE_FIXED_DECODER)
+
+
+typedef struct {
+    uint32_t numContacts;
+    uint32_t stride;
+    HIDReportDecoder decoder;
+} FixedShape;
+
+static const FixedShape gFixedShapes[] = {
+#define HID_FIXED_SHAPE_ENTRY(contacts, stride) \
+    { contacts, stride, { "fixed " #contacts "x" #stride, HID_FIXED_DECODER_NAME(contacts, stride) } },
+    HID_FIXED_SHAPES(HID_FIXED_SHAPE_ENTRY)
+#undef HID_FIXED_SHAPE_ENTRY
+};
+
+
+
+static bool FieldIs(const HIDField *field, uint32_t bitOffset, uint32_t bitSize) {
+    return field->bitOffset == bitOffset && field->bitSize == bitSize && !field->isSigned;
+}
+
+static bool LayoutMatchesFixedShape(const HIDReportLayout *layout, uint32_t numContacts, uint32_t stride) {
+    if (layout->reportID == 0 || layout->numContacts != numContacts) {
+        return false;
+    }
+    if (layout->reportSize < HID_FIXED_FIRST_BYTE + numContacts * stride) {
+        return false;
+    }
+
+    for (uint32_t i=0; i<numContacts; i++) {
+        const HIDContactLayout *contact = &layout->contacts[i];
+        uint32_t base = (HID_FIXED_FIRST_BYTE + i * stride) * 8;
+
+        if (   !FieldIs(&contact->tipSwitch,  base,      1)
+            || !FieldIs(&contact->confidence, base + 1,  1)
+            || !FieldIs(&contact->contactID,  base + 8,  8)
+            || !FieldIs(&contact->x,          base + 16, 16)
+            || !FieldIs(&contact->y,          base + 32, 16)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+
+#pragma mark - Selection
+
+/**
+ The fixed decoders are picked by the shape of the report alone: every offset they assume is checked against the compiled layout,
+ so they are safe for any device that happens to share the shape.
+ */
+HIDReportDecoder HIDReportDecoderForLayout(const HIDReportLayout *layout) {
+    const size_t numShapes = sizeof(gFixedShapes) / sizeof(gFixedShapes[0]);
+
+    for (size_t i=0; i<numShapes; i++) {
+        if (LayoutMatchesFixedShape(layout, gFixedShapes[i].numContacts, gFixedShapes[i].stride)) {
+            return gFixedShapes[i].decoder;
+        }
+    }
+
+    HIDReportDecoder generic = { "generic", HIDDecodeReportGeneric };
+    return generic;
+}
+
+
+
+#pragma mark - Pen
+
+static inline uint8_t ReadSwitch(const uint8_t *report, const HIDField *field) {
+    return HIDFieldIsPresent(field) && HIDFieldRead(report, field) != 0;
+}
+
+
+static inline float ReadNormalized(const uint8_t *report, const HIDField *field) {
+    return (float)(HIDFieldRead(report, field) - field->logicalMin) / (float)(field->logicalMax - field->logicalMin);
+}
+
+
+/**
+ Tilt is reported symmetrically around 0 (usually -9000...9000 in 0.01 degrees), so it is scaled by the larger bound to -1...1.
+ */
+static inline float ReadTilt(const uint8_t *report, const HIDField *field) {
+    if (!HIDFieldIsPresent(field)) {
+        return 0;
+    }
+    int32_t bound = field->logicalMax > -field->logicalMin ? field->logicalMax : -field->logicalMin;
+    return bound > 0 ? (float)HIDFieldRead(report, field) / (float)bound : 0;
+}
+
+
+bool HIDDecodePenReport(const HIDPenLayout *layout, const uint8_t *report, size_t length, HIDPenSample *sample) {
+    if (length < layout->reportSize) {
+        return false;
+    }
+
+    sample->tipSwitch    = ReadSwitch(report, &layout->tipSwitch);
+    sample->barrelSwitch = ReadSwitch(report, &layout->barrelSwitch);
+    sample->eraser       = ReadSwitch(report, &layout->eraser) || ReadSwitch(report, &layout->invert);
+    sample->inRange      = HIDFieldIsPresent(&layout->inRange) ? ReadSwitch(report, &layout->inRange) : sample->tipSwitch;
+
+    sample->x = ReadNormalized(report, &layout->x);
+    sample->y = ReadNormalized(report, &layout->y);
+
+    if (HIDFieldIsPresent(&layout->tipPressure) && layout->tipPressure.logicalMax > layout->tipPressure.logicalMin) {
+        sample->pressure = ReadNormalized(report, &layout->tipPressure);
+    } else {
+        sample->pressure = sample->tipSwitch ? 1 : 0;
+    }
+
+    sample->tiltX = ReadTilt(report, &layout->xTilt);
+    sample->tiltY = ReadTilt(report, &layout->yTilt);
+    return true;
+}
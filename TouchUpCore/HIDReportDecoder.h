@@ -0,0 +1,90 @@
+//
+//  HIDReportDecoder.h
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef HIDReportDecoder_h
+#define HIDReportDecoder_h
+
+#include "HIDReportLayout.h"
+
+/**
+ Decoders turn one raw touch report into a frame of contacts with normalized coordinates.
+ The generic decoder works for every compiled layout. For layouts common in our fleet there are specialized decoders with all offsets
+ known at compile time; they are picked when a device connects, see `HIDReportDecoderForLayout`.
+ */
+
+/**
+ The contacts are stored as struct of arrays, one array per value. Arrays are always full size so kernels can process whole
+ vectors, only the first `numContacts` entries are valid.
+ */
+typedef struct {
+    uint64_t timestamp;         // of the report, mach absolute time
+    const uint8_t *report;      // the raw report while the frame passes the pipeline, NULL otherwise
+    uint32_t reportLength;
+    int32_t  contactCount;      // as reported by the device, 0 in follow-up reports of hybrid mode, -1 if unknown
+    int32_t  scanTime;          // -1 if the device does not report it
+    uint32_t numContacts;
+
+    uint32_t tipSwitch[HID_MAX_CONTACTS_PER_REPORT];
+    uint32_t confidence[HID_MAX_CONTACTS_PER_REPORT];   // 0 if the device does not report it
+    uint32_t contactID[HID_MAX_CONTACTS_PER_REPORT];
+    int32_t  rawX[HID_MAX_CONTACTS_PER_REPORT];         // logical values
+    int32_t  rawY[HID_MAX_CONTACTS_PER_REPORT];
+    float    x[HID_MAX_CONTACTS_PER_REPORT];            // 0...1 in digitizer orientation
+    float    y[HID_MAX_CONTACTS_PER_REPORT];
+} HIDContactFrame;
+
+
+/**
+ Decodes `report` into `frame`. Returns false if the report is too short for the layout.
+ */
+typedef bool (*HIDReportDecoderFunction)(const HIDReportLayout *layout, const uint8_t *report, size_t length, HIDContactFrame *frame);
+
+typedef struct {
+    const char *name;
+    HIDReportDecoderFunction decode;
+} HIDReportDecoder;
+
+
+/**
+ Looks up a specialized decoder for the shape of the report. Returns the generic decoder if there is none.
+ */
+HIDReportDecoder HIDReportDecoderForLayout(const HIDReportLayout *layout);
+
+/**
+ Unpacks and normalizes all contacts with the vector kernels. Works for every layout.
+ */
+bool HIDDecodeReportGeneric(const HIDReportLayout *layout, const uint8_t *report, size_t length, HIDContactFrame *frame);
+
+/**
+ Reads every value through its field description. Reference for all other decoders.
+ */
+bool HIDDecodeReportReference(const HIDReportLayout *layout, const uint8_t *report, size_t length, HIDContactFrame *frame);
+
+
+
+#pragma mark - Pen
+
+typedef struct {
+    uint64_t timestamp;         // of the report, mach absolute time
+    float    x;                 // 0...1 in digitizer orientation
+    float    y;
+    float    pressure;          // 0...1, pens without pressure report 1 while touching
+    float    tiltX;             // -1...1, 0 if the pen does not report tilt
+    float    tiltY;
+    uint8_t  inRange;
+    uint8_t  tipSwitch;
+    uint8_t  barrelSwitch;
+    uint8_t  eraser;            // the eraser end is in range or touching
+} HIDPenSample;
+
+
+/**
+ Decodes one pen report. Returns false if the report is too short for the layout.
+ */
+bool HIDDecodePenReport(const HIDPenLayout *layout, const uint8_t *report, size_t length, HIDPenSample *sample);
+
+#endif /* HIDReportDecoder_h */
@@ -0,0 +1,595 @@
+//
+//  HIDReportLayout.c
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "HIDReportLayout.h"
+
+#include <string.h>
+
+#pragma mark - Descriptor Items
+
+// HID 1.11, 6.2.2: item types and tags
+#define HID_ITEM_TYPE_MAIN      0
+#define HID_ITEM_TYPE_GLOBAL    1
+#define HID_ITEM_TYPE_LOCAL     2
+
+#define HID_MAIN_INPUT          0x8
+#define HID_MAIN_OUTPUT         0x9
+#define HID_MAIN_COLLECTION     0xA
+#define HID_MAIN_FEATURE        0xB
+#define HID_MAIN_END_COLLECTION 0xC
+
+#define HID_GLOBAL_USAGE_PAGE   0x0
+#define HID_GLOBAL_LOGICAL_MIN  0x1
+#define HID_GLOBAL_LOGICAL_MAX  0x2
+#define HID_GLOBAL_REPORT_SIZE  0x7
+#define HID_GLOBAL_REPORT_ID    0x8
+#define HID_GLOBAL_REPORT_COUNT 0x9
+#define HID_GLOBAL_PUSH         0xA
+#define HID_GLOBAL_POP          0xB
+
+#define HID_LOCAL_USAGE         0x0
+#define HID_LOCAL_USAGE_MIN     0x1
+#define HID_LOCAL_USAGE_MAX     0x2
+
+#define HID_LONG_ITEM_PREFIX    0xFE
+
+#define HID_MAX_USAGES          64
+#define HID_MAX_DEPTH           16
+
+#define HID_COLLECTION_APPLICATION  1
+#define HID_COLLECTION_LOGICAL      2
+
+// usages from the Generic Desktop (0x01) and Digitizer (0x0D) pages
+#define HID_USAGE_GD_X              HIDUsage(0x01, 0x30)
+#define HID_USAGE_GD_Y              HIDUsage(0x01, 0x31)
+#define HID_USAGE_DIG_PEN           HIDUsage(0x0D, 0x02)
+#define HID_USAGE_DIG_TOUCHSCREEN   HIDUsage(0x0D, 0x04)
+#define HID_USAGE_DIG_CONFIGURATION HIDUsage(0x0D, 0x0E)
+#define HID_USAGE_DIG_STYLUS        HIDUsage(0x0D, 0x20)
+#define HID_USAGE_DIG_FINGER        HIDUsage(0x0D, 0x22)
+#define HID_USAGE_DIG_TIP_PRESSURE  HIDUsage(0x0D, 0x30)
+#define HID_USAGE_DIG_IN_RANGE      HIDUsage(0x0D, 0x32)
+#define HID_USAGE_DIG_INVERT        HIDUsage(0x0D, 0x3C)
+#define HID_USAGE_DIG_X_TILT        HIDUsage(0x0D, 0x3D)
+#define HID_USAGE_DIG_Y_TILT        HIDUsage(0x0D, 0x3E)
+#define HID_USAGE_DIG_AZIMUTH       HIDUsage(0x0D, 0x3F)
+#define HID_USAGE_DIG_TIP_SWITCH    HIDUsage(0x0D, 0x42)
+#define HID_USAGE_DIG_BARREL_SWITCH HIDUsage(0x0D, 0x44)
+#define HID_USAGE_DIG_ERASER        HIDUsage(0x0D, 0x45)
+#define HID_USAGE_DIG_CONFIDENCE    HIDUsage(0x0D, 0x47)
+#define HID_USAGE_DIG_WIDTH         HIDUsage(0x0D, 0x48)
+#define HID_USAGE_DIG_HEIGHT        HIDUsage(0x0D, 0x49)
+#define HID_USAGE_DIG_CONTACT_ID    HIDUsage(0x0D, 0x51)
+#define HID_USAGE_DIG_INPUT_MODE    HIDUsage(0x0D, 0x52)
+#define HID_USAGE_DIG_CONTACT_COUNT HIDUsage(0x0D, 0x54)
+#define HID_USAGE_DIG_CONTACT_MAX   HIDUsage(0x0D, 0x55)
+#define HID_USAGE_DIG_SCAN_TIME     HIDUsage(0x0D, 0x56)
+#define HID_USAGE_DIG_LATENCY_MODE  HIDUsage(0x0D, 0x60)
+
+
+typedef struct {
+    uint32_t usagePage;
+    int32_t  logicalMin;
+    int32_t  logicalMax;
+    uint32_t logicalMaxUnsigned;    // the maximum was meant unsigned if it is smaller than the minimum
+    uint32_t reportSize;
+    uint32_t reportCount;
+    uint8_t  reportID;
+} HIDGlobalState;
+
+
+static uint32_t ItemUnsignedValue(const uint8_t *data, uint32_t size) {
+    uint32_t value = 0;
+    for (uint32_t i=0; i<size; i++) {
+        value |= (uint32_t)data[i] << (8 * i);
+    }
+    return value;
+}
+
+static int32_t ItemSignedValue(const uint8_t *data, uint32_t size) {
+    uint32_t value = ItemUnsignedValue(data, size);
+    if (size > 0 && size < 4 && (value & (1u << (8 * size - 1)))) {
+        value |= ~((1u << (8 * size)) - 1);
+    }
+    return (int32_t)value;
+}
+
+
+
+bool HIDDescriptorWalk(const uint8_t *descriptor, size_t length, HIDDescriptorVisitor visitor, void *context) {
+    HIDGlobalState global = {0};
+    HIDGlobalState globalStack[4];
+    uint32_t globalDepth = 0;
+
+    uint32_t usages[HID_MAX_USAGES];
+    uint32_t numUsages = 0;
+    uint32_t usageMin = 0;
+    uint32_t usageMax = 0;
+    bool hasUsageRange = false;
+
+    struct { uint8_t type; uint32_t usage; uint32_t index; } collections[HID_MAX_DEPTH];
+    uint32_t depth = 0;
+    uint32_t collectionCounter = 0;
+    uint32_t applicationUsage = 0;
+
+    uint32_t bitOffsets[HIDReportTypeCount][256];
+    memset(bitOffsets, 0, sizeof(bitOffsets));
+
+    size_t i = 0;
+    while (i < length) {
+        uint8_t prefix = descriptor[i];
+
+        if (prefix == HID_LONG_ITEM_PREFIX) {
+            if (i + 1 >= length) return false;
+            i += 3 + descriptor[i+1];
+            continue;
+        }
+
+        uint32_t size = prefix & 0x3;
+        if (size == 3) size = 4;
+        uint32_t type = (prefix >> 2) & 0x3;
+        uint32_t tag  = prefix >> 4;
+
+        if (i + 1 + size > length) {
+            return false;
+        }
+        const uint8_t *data = &descriptor[i+1];
+        i += 1 + size;
+
+        if (type == HID_ITEM_TYPE_GLOBAL) {
+            switch (tag) {
+                case HID_GLOBAL_USAGE_PAGE:   global.usagePage = ItemUnsignedValue(data, size); break;
+                case HID_GLOBAL_LOGICAL_MIN:  global.logicalMin = ItemSignedValue(data, size); break;
+                case HID_GLOBAL_LOGICAL_MAX:
+                    global.logicalMax = ItemSignedValue(data, size);
+                    global.logicalMaxUnsigned = ItemUnsignedValue(data, size);
+                    break;
+                case HID_GLOBAL_REPORT_SIZE:  global.reportSize = ItemUnsignedValue(data, size); break;
+                case HID_GLOBAL_REPORT_COUNT: global.reportCount = ItemUnsignedValue(data, size); break;
+                case HID_GLOBAL_REPORT_ID:
+                    global.reportID = (uint8_t)ItemUnsignedValue(data, size);
+                    // the report ID is the first byte of each of its reports
+                    for (int t=0; t<HIDReportTypeCount; t++) {
+                        if (bitOffsets[t][global.reportID] == 0) {
+                            bitOffsets[t][global.reportID] = 8;
+                        }
+                    }
+                    break;
+                case HID_GLOBAL_PUSH:
+                    if (globalDepth == 4) return false;
+                    globalStack[globalDepth++] = global;
+                    break;
+                case HID_GLOBAL_POP:
+                    if (globalDepth == 0) return false;
+                    global = globalStack[--globalDepth];
+                    break;
+                default: break;
+            }
+            continue;
+        }
+
+        if (type == HID_ITEM_TYPE_LOCAL) {
+            uint32_t value = ItemUnsignedValue(data, size);
+            if (size < 4) {
+                value = HIDUsage(global.usagePage, value);
+            }
+            if (tag == HID_LOCAL_USAGE && numUsages < HID_MAX_USAGES) {
+                usages[numUsages++] = value;
+            } else if (tag == HID_LOCAL_USAGE_MIN) {
+                usageMin = value;
+                hasUsageRange = true;
+            } else if (tag == HID_LOCAL_USAGE_MAX) {
+                usageMax = value;
+                hasUsageRange = true;
+            }
+            continue;
+        }
+
+        if (type != HID_ITEM_TYPE_MAIN) {
+            continue;
+        }
+
+        if (tag == HID_MAIN_COLLECTION) {
+            if (depth == HID_MAX_DEPTH) return false;
+            uint8_t collectionType = (uint8_t)ItemUnsignedValue(data, size);
+            uint32_t usage = numUsages > 0 ? usages[0] : (hasUsageRange ? usageMin : 0);
+
+            collections[depth].type  = collectionType;
+            collections[depth].usage = usage;
+            collections[depth].index = ++collectionCounter;
+            depth++;
+
+            if (collectionType == HID_COLLECTION_APPLICATION) {
+                applicationUsage = usage;
+            }
+
+        } else if (tag == HID_MAIN_END_COLLECTION) {
+            if (depth == 0) return false;
+            depth--;
+            if (collections[depth].type == HID_COLLECTION_APPLICATION) {
+                applicationUsage = 0;
+            }
+
+        } else if (tag == HID_MAIN_INPUT || tag == HID_MAIN_OUTPUT || tag == HID_MAIN_FEATURE) {
+            HIDReportType reportType = tag == HID_MAIN_INPUT  ? HIDReportTypeInput
+                                     : tag == HID_MAIN_OUTPUT ? HIDReportTypeOutput
+                                     :                          HIDReportTypeFeature;
+            uint32_t flags = ItemUnsignedValue(data, size);
+            bool isConstant = flags & 0x1;
+            bool isVariable = flags & 0x2;
+
+            HIDDescriptorField field = {0};
+            field.type             = reportType;
+            field.reportID         = global.reportID;
+            field.isConstant       = isConstant;
+            field.applicationUsage = applicationUsage;
+            field.collectionUsage  = depth > 0 ? collections[depth-1].usage : 0;
+            field.collectionType   = depth > 0 ? collections[depth-1].type  : 0;
+            field.collectionIndex  = depth > 0 ? collections[depth-1].index : 0;
+
+            field.field.bitSize    = (uint8_t)(global.reportSize > 32 ? 32 : global.reportSize);
+            field.field.logicalMin = global.logicalMin;
+            field.field.logicalMax = global.logicalMax;
+            if (global.logicalMax < global.logicalMin) {
+                field.field.logicalMax = (int32_t)global.logicalMaxUnsigned;
+            }
+            field.field.isSigned   = global.logicalMin < 0;
+
+            uint32_t *offset = &bitOffsets[reportType][global.reportID];
+
+            for (uint32_t n=0; n<global.reportCount; n++) {
+                uint32_t usage = 0;
+                if (hasUsageRange) {
+                    usage = usageMin + (isVariable ? n : 0);
+                    if (usage > usageMax) usage = usageMax;
+                } else if (numUsages > 0) {
+                    usage = usages[(isVariable && n < numUsages) ? n : (isVariable ? numUsages - 1 : 0)];
+                }
+
+                field.usage = usage;
+                field.field.bitOffset = (uint16_t)*offset;
+
+                if (visitor) {
+                    visitor(&field, context);
+                }
+                *offset += global.reportSize;
+            }
+        }
+
+        // local items only apply to the next main item
+        numUsages = 0;
+        hasUsageRange = false;
+        usageMin = usageMax = 0;
+    }
+
+    return depth == 0;
+}
+
+
+
+#pragma mark - Touch Report Layout
+
+uint64_t HIDReportDescriptorHash(const uint8_t *descriptor, size_t length) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i=0; i<length; i++) {
+        hash ^= descriptor[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+
+
+typedef struct {
+    HIDReportLayout *layout;
+    bool     hasReportID;
+    uint32_t currentCollection;
+    bool     tooManyContacts;
+
+    HIDField contactCountCandidates[256];
+    HIDField scanTimeCandidates[256];
+    uint32_t reportEnds[256];   // in bits
+} LayoutCompilation;
+
+
+static void VisitTouchField(const HIDDescriptorField *f, void *context) {
+    LayoutCompilation *c = context;
+    HIDReportLayout *layout = c->layout;
+
+    if (f->type != HIDReportTypeInput) {
+        return;
+    }
+
+    uint32_t end = f->field.bitOffset + f->field.bitSize;
+    if (end > c->reportEnds[f->reportID]) {
+        c->reportEnds[f->reportID] = end;
+    }
+
+    if (f->isConstant || f->applicationUsage != HID_USAGE_DIG_TOUCHSCREEN) {
+        return;
+    }
+
+    bool isFingerCollection = f->collectionUsage == HID_USAGE_DIG_FINGER || f->collectionType == HID_COLLECTION_LOGICAL;
+
+    if (!isFingerCollection) {
+        if (f->usage == HID_USAGE_DIG_CONTACT_COUNT) {
+            c->contactCountCandidates[f->reportID] = f->field;
+        } else if (f->usage == HID_USAGE_DIG_SCAN_TIME) {
+            c->scanTimeCandidates[f->reportID] = f->field;
+        }
+        return;
+    }
+
+    // the first finger decides which report we are interested in
+    if (!c->hasReportID) {
+        c->hasReportID = true;
+        layout->reportID = f->reportID;
+    }
+    if (f->reportID != layout->reportID) {
+        return;
+    }
+
+    if (f->collectionIndex != c->currentCollection) {
+        c->currentCollection = f->collectionIndex;
+        if (layout->numContacts == HID_MAX_CONTACTS_PER_REPORT) {
+            c->tooManyContacts = true;
+            return;
+        }
+        layout->numContacts++;
+    }
+    if (c->tooManyContacts) {
+        return;
+    }
+
+    HIDContactLayout *contact = &layout->contacts[layout->numContacts - 1];
+
+    switch (f->usage) {
+        case HID_USAGE_DIG_TIP_SWITCH:  contact->tipSwitch  = f->field; break;
+        case HID_USAGE_DIG_CONFIDENCE:  contact->confidence = f->field; break;
+        case HID_USAGE_DIG_CONTACT_ID:  contact->contactID  = f->field; break;
+        case HID_USAGE_GD_X:            contact->x          = f->field; break;
+        case HID_USAGE_GD_Y:            contact->y          = f->field; break;
+        case HID_USAGE_DIG_WIDTH:       contact->width      = f->field; break;
+        case HID_USAGE_DIG_HEIGHT:      contact->height     = f->field; break;
+        case HID_USAGE_DIG_AZIMUTH:     contact->azimuth    = f->field; break;
+        default: break;
+    }
+}
+
+
+
+static void PrepareFieldPlan(HIDReportLayout *layout, size_t fieldOffset, HIDFieldPlan *plan) {
+    const HIDField *first = (const HIDField *)((const uint8_t *)&layout->contacts[0] + fieldOffset);
+
+    memset(plan, 0, sizeof(HIDFieldPlan));
+    plan->isPresent  = HIDFieldIsPresent(first);
+    plan->isPackable = plan->isPresent;
+    plan->mask = first->bitSize >= 32 ? 0xFFFFFFFF : (1u << first->bitSize) - 1;
+
+    for (uint32_t i=0; i<layout->numContacts; i++) {
+        const HIDField *field = (const HIDField *)((const uint8_t *)&layout->contacts[i] + fieldOffset);
+
+        plan->byteOffset[i] = field->bitOffset >> 3;
+        plan->shift[i]      = field->bitOffset & 7;
+
+        if (field->bitSize != first->bitSize || field->isSigned || plan->shift[i] + field->bitSize > 32) {
+            plan->isPackable = 0;
+        }
+        if (plan->isPresent && plan->byteOffset[i] + 4 > layout->plan.loadEnd) {
+            layout->plan.loadEnd = plan->byteOffset[i] + 4;
+        }
+    }
+}
+
+
+static void PrepareUnpackPlan(HIDReportLayout *layout) {
+    HIDUnpackPlan *plan = &layout->plan;
+
+    PrepareFieldPlan(layout, offsetof(HIDContactLayout, tipSwitch),  &plan->tipSwitch);
+    PrepareFieldPlan(layout, offsetof(HIDContactLayout, confidence), &plan->confidence);
+    PrepareFieldPlan(layout, offsetof(HIDContactLayout, contactID),  &plan->contactID);
+    PrepareFieldPlan(layout, offsetof(HIDContactLayout, x),          &plan->x);
+    PrepareFieldPlan(layout, offsetof(HIDContactLayout, y),          &plan->y);
+
+    for (uint32_t i=0; i<layout->numContacts; i++) {
+        const HIDContactLayout *contact = &layout->contacts[i];
+        plan->xMin[i]   = (float)contact->x.logicalMin;
+        plan->xScale[i] = 1.0f / (float)(contact->x.logicalMax - contact->x.logicalMin);
+        plan->yMin[i]   = (float)contact->y.logicalMin;
+        plan->yScale[i] = 1.0f / (float)(contact->y.logicalMax - contact->y.logicalMin);
+    }
+}
+
+
+
+bool HIDReportLayoutCompile(const uint8_t *descriptor, size_t length, HIDReportLayout *layout) {
+    memset(layout, 0, sizeof(HIDReportLayout));
+    layout->descriptorHash = HIDReportDescriptorHash(descriptor, length);
+
+    LayoutCompilation compilation;
+    memset(&compilation, 0, sizeof(compilation));
+    compilation.layout = layout;
+
+    if (!HIDDescriptorWalk(descriptor, length, VisitTouchField, &compilation)) {
+        return false;
+    }
+
+    if (!compilation.hasReportID || compilation.tooManyContacts || layout->numContacts == 0) {
+        return false;
+    }
+
+    for (uint32_t i=0; i<layout->numContacts; i++) {
+        const HIDContactLayout *contact = &layout->contacts[i];
+        if (!HIDFieldIsPresent(&contact->tipSwitch) || !HIDFieldIsPresent(&contact->x) || !HIDFieldIsPresent(&contact->y)) {
+            return false;
+        }
+        if (layout->numContacts > 1 && !HIDFieldIsPresent(&contact->contactID)) {
+            return false;
+        }
+        if (contact->x.logicalMax <= contact->x.logicalMin || contact->y.logicalMax <= contact->y.logicalMin) {
+            return false;
+        }
+    }
+
+    layout->contactCount = compilation.contactCountCandidates[layout->reportID];
+    layout->scanTime     = compilation.scanTimeCandidates[layout->reportID];
+    layout->reportSize   = (uint16_t)((compilation.reportEnds[layout->reportID] + 7) / 8);
+
+    PrepareUnpackPlan(layout);
+
+    return true;
+}
+
+
+
+#pragma mark - Pen Report Layout
+
+typedef struct {
+    HIDPenLayout *layout;
+    bool     hasReportID;
+    uint32_t reportEnds[256];   // in bits
+} PenLayoutCompilation;
+
+
+static void VisitPenField(const HIDDescriptorField *f, void *context) {
+    PenLayoutCompilation *c = context;
+    HIDPenLayout *layout = c->layout;
+
+    if (f->type != HIDReportTypeInput) {
+        return;
+    }
+
+    uint32_t end = f->field.bitOffset + f->field.bitSize;
+    if (end > c->reportEnds[f->reportID]) {
+        c->reportEnds[f->reportID] = end;
+    }
+
+    bool isPenCollection = f->applicationUsage == HID_USAGE_DIG_PEN || f->collectionUsage == HID_USAGE_DIG_STYLUS;
+    if (f->isConstant || !isPenCollection) {
+        return;
+    }
+
+    // the first pen value decides which report we are interested in
+    if (!c->hasReportID) {
+        c->hasReportID = true;
+        layout->reportID = f->reportID;
+    }
+    if (f->reportID != layout->reportID) {
+        return;
+    }
+
+    switch (f->usage) {
+        case HID_USAGE_DIG_IN_RANGE:        layout->inRange      = f->field; break;
+        case HID_USAGE_DIG_TIP_SWITCH:      layout->tipSwitch    = f->field; break;
+        case HID_USAGE_DIG_BARREL_SWITCH:   layout->barrelSwitch = f->field; break;
+        case HID_USAGE_DIG_ERASER:          layout->eraser       = f->field; break;
+        case HID_USAGE_DIG_INVERT:          layout->invert       = f->field; break;
+        case HID_USAGE_GD_X:                layout->x            = f->field; break;
+        case HID_USAGE_GD_Y:                layout->y            = f->field; break;
+        case HID_USAGE_DIG_TIP_PRESSURE:    layout->tipPressure  = f->field; break;
+        case HID_USAGE_DIG_X_TILT:          layout->xTilt        = f->field; break;
+        case HID_USAGE_DIG_Y_TILT:          layout->yTilt        = f->field; break;
+        default: break;
+    }
+}
+
+
+bool HIDPenLayoutCompile(const uint8_t *descriptor, size_t length, HIDPenLayout *layout) {
+    memset(layout, 0, sizeof(HIDPenLayout));
+
+    PenLayoutCompilation compilation;
+    memset(&compilation, 0, sizeof(compilation));
+    compilation.layout = layout;
+
+    if (!HIDDescriptorWalk(descriptor, length, VisitPenField, &compilation)) {
+        return false;
+    }
+
+    if (!compilation.hasReportID || !HIDFieldIsPresent(&layout->tipSwitch)
+        || !HIDFieldIsPresent(&layout->x) || !HIDFieldIsPresent(&layout->y)) {
+        return false;
+    }
+    if (layout->x.logicalMax <= layout->x.logicalMin || layout->y.logicalMax <= layout->y.logicalMin) {
+        return false;
+    }
+
+    layout->reportSize = (uint16_t)((compilation.reportEnds[layout->reportID] + 7) / 8);
+
+    return true;
+}
+
+
+
+#pragma mark - Device Configuration
+
+typedef struct {
+    HIDConfigurationLayout *layout;
+    uint32_t reportEnds[256];   // in bits
+} ConfigurationCompilation;
+
+
+static void VisitConfigurationField(const HIDDescriptorField *f, void *context) {
+    ConfigurationCompilation *c = context;
+    HIDConfigurationLayout *layout = c->layout;
+
+    if (f->type != HIDReportTypeFeature) {
+        return;
+    }
+
+    uint32_t end = f->field.bitOffset + f->field.bitSize;
+    if (end > c->reportEnds[f->reportID]) {
+        c->reportEnds[f->reportID] = end;
+    }
+
+    bool isTouchscreen = f->applicationUsage == HID_USAGE_DIG_TOUCHSCREEN || f->applicationUsage == HID_USAGE_DIG_CONFIGURATION;
+    if (f->isConstant || !isTouchscreen) {
+        return;
+    }
+
+    HIDFeatureValue *value = NULL;
+    switch (f->usage) {
+        case HID_USAGE_DIG_INPUT_MODE:      value = &layout->inputMode;           break;
+        case HID_USAGE_DIG_LATENCY_MODE:    value = &layout->latencyMode;         break;
+        case HID_USAGE_DIG_CONTACT_MAX:     value = &layout->contactCountMaximum; break;
+        default: return;
+    }
+
+    // the first occurrence counts
+    if (!HIDFieldIsPresent(&value->field)) {
+        value->usage = f->usage;
+        value->reportID = f->reportID;
+        value->field = f->field;
+    }
+}
+
+
+static void FinishFeatureValue(const ConfigurationCompilation *c, HIDFeatureValue *value) {
+    if (HIDFieldIsPresent(&value->field)) {
+        value->reportSize = (uint16_t)((c->reportEnds[value->reportID] + 7) / 8);
+    }
+}
+
+
+bool HIDConfigurationLayoutCompile(const uint8_t *descriptor, size_t length, HIDConfigurationLayout *layout) {
+    memset(layout, 0, sizeof(HIDConfigurationLayout));
+
+    ConfigurationCompilation compilation;
+    memset(&compilation, 0, sizeof(compilation));
+    compilation.layout = layout;
+
+    if (!HIDDescriptorWalk(descriptor, length, VisitConfigurationField, &compilation)) {
+        return false;
+    }
+
+    FinishFeatureValue(&compilation, &layout->inputMode);
+    FinishFeatureValue(&compilation, &layout->latencyMode);
+    FinishFeatureValue(&compilation, &layout->contactCountMaximum);
+
+    return HIDFieldIsPresent(&layout->inputMode.field)
+        || HIDFieldIsPresent(&layout->latencyMode.field)
+        || HIDFieldIsPresent(&layout->contactCountMaximum.field);
+}
@@ -0,0 +1,248 @@
+//
+//  HIDReportLayout.h
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef HIDReportLayout_h
+#define HIDReportLayout_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ A report layout is the compiled form of a touchscreen's report descriptor: for every value of the touch report it stores where it is in the raw report.
+ With it, reports can be decoded directly instead of walking the IOHIDElement tree for every value.
+ The struct is plain data without pointers.
+ */
+
+#define HID_MAX_CONTACTS_PER_REPORT 16
+
+
+typedef struct {
+    uint16_t bitOffset;     // from the start of the report, including the report ID byte
+    uint8_t  bitSize;       // 0 if the device does not report this value
+    uint8_t  isSigned;
+    int32_t  logicalMin;
+    int32_t  logicalMax;
+} HIDField;
+
+
+typedef struct {
+    HIDField tipSwitch;
+    HIDField confidence;
+    HIDField contactID;
+    HIDField x;
+    HIDField y;
+    HIDField width;
+    HIDField height;
+    HIDField azimuth;
+} HIDContactLayout;
+
+
+/**
+ Where one value is found in every contact, arranged by value instead of by contact so all contacts of a report can be unpacked at once.
+ */
+typedef struct {
+    uint32_t byteOffset[HID_MAX_CONTACTS_PER_REPORT];   // 0 for unused contacts, so vector loads stay inside the report
+    uint32_t shift[HID_MAX_CONTACTS_PER_REPORT];
+    uint32_t mask;
+    uint8_t  isPresent;
+    uint8_t  isPackable;    // unsigned, same size in every contact and readable with one 32 bit load
+} HIDFieldPlan;
+
+typedef struct {
+    HIDFieldPlan tipSwitch;
+    HIDFieldPlan confidence;
+    HIDFieldPlan contactID;
+    HIDFieldPlan x;
+    HIDFieldPlan y;
+
+    // normalized = (raw - min) * scale
+    float xMin[HID_MAX_CONTACTS_PER_REPORT];
+    float xScale[HID_MAX_CONTACTS_PER_REPORT];
+    float yMin[HID_MAX_CONTACTS_PER_REPORT];
+    float yScale[HID_MAX_CONTACTS_PER_REPORT];
+
+    uint32_t loadEnd;       // reports shorter than this are copied before unpacking
+} HIDUnpackPlan;
+
+
+typedef struct {
+    uint32_t vendorID;
+    uint32_t productID;
+    uint64_t descriptorHash;
+
+    uint8_t  reportID;          // 0 if the device does not use report IDs
+    uint16_t reportSize;        // in bytes, including the report ID
+    uint8_t  numContacts;       // number of finger collections in one report
+
+    HIDField contactCount;
+    HIDField scanTime;
+    HIDContactLayout contacts[HID_MAX_CONTACTS_PER_REPORT];
+
+    HIDUnpackPlan plan;
+} HIDReportLayout;
+
+
+
+#pragma mark - Descriptor Parsing
+
+typedef enum {
+    HIDReportTypeInput,
+    HIDReportTypeOutput,
+    HIDReportTypeFeature,
+    HIDReportTypeCount
+} HIDReportType;
+
+#define HIDUsage(page, usage) (((uint32_t)(page) << 16) | (uint32_t)(usage))
+
+/**
+ One value of a report, as found while walking the descriptor.
+ */
+typedef struct {
+    HIDReportType type;
+    uint8_t  reportID;
+    uint8_t  isConstant;        // padding
+    HIDField field;
+    uint32_t usage;             // HIDUsage(page, usage)
+
+    uint32_t applicationUsage;  // usage of the enclosing application collection
+    uint32_t collectionUsage;   // usage of the innermost collection
+    uint8_t  collectionType;    // 0 physical, 1 application, 2 logical, ...
+    uint32_t collectionIndex;   // increases with every collection, to group values by collection
+} HIDDescriptorField;
+
+typedef void (*HIDDescriptorVisitor)(const HIDDescriptorField *field, void *context);
+
+/**
+ Calls the visitor for every value of every report in the descriptor. Returns false if the descriptor is malformed.
+ */
+bool HIDDescriptorWalk(const uint8_t *descriptor, size_t length, HIDDescriptorVisitor visitor, void *context);
+
+
+
+#pragma mark - Touch Report Layout
+
+/**
+ FNV-1a hash of the raw report descriptor. Identifies a layout together with vendor and product ID.
+ */
+uint64_t HIDReportDescriptorHash(const uint8_t *descriptor, size_t length);
+
+/**
+ Parses the report descriptor and fills in the layout of the first input report that carries finger collections of a touch screen.
+ Returns false if the descriptor contains no such report, the device then has to be decoded via its elements.
+ */
+bool HIDReportLayoutCompile(const uint8_t *descriptor, size_t length, HIDReportLayout *layout);
+
+
+
+#pragma mark - Pen Report Layout
+
+/**
+ Layout of the report of a pen, either from a pen digitizer or from the pen collection of a touchscreen that also supports a stylus.
+ Pens report a single transducer, so there is only one set of values.
+ */
+typedef struct {
+    uint8_t  reportID;
+    uint16_t reportSize;        // in bytes, including the report ID
+
+    HIDField inRange;           // hovering above the surface or touching it
+    HIDField tipSwitch;
+    HIDField barrelSwitch;
+    HIDField eraser;            // the eraser end touches the surface
+    HIDField invert;            // the eraser end is in range
+    HIDField x;
+    HIDField y;
+    HIDField tipPressure;
+    HIDField xTilt;
+    HIDField yTilt;
+} HIDPenLayout;
+
+/**
+ Fills in the layout of the first input report with a pen or stylus collection. Returns false if the descriptor has none.
+ */
+bool HIDPenLayoutCompile(const uint8_t *descriptor, size_t length, HIDPenLayout *layout);
+
+
+
+#pragma mark - Device Configuration
+
+/**
+ A value of a feature report. The report is read from the device, the value changed, and the whole report written back.
+ */
+typedef struct {
+    uint32_t usage;             // HIDUsage(page, usage)
+    uint8_t  reportID;
+    uint16_t reportSize;        // in bytes, including the report ID
+    HIDField field;             // not present if the device has no such value
+} HIDFeatureValue;
+
+/**
+ The feature reports a Windows-compatible touchscreen is configured with. Windows sets the input mode when the screen connects,
+ until then many screens stay in a mode that reports a single contact or act as a mouse.
+ */
+typedef struct {
+    HIDFeatureValue inputMode;              // 0 mouse, 1 single input, 2 multi-input
+    HIDFeatureValue latencyMode;            // 0 normal, 1 high latency (reports less often to save power)
+    HIDFeatureValue contactCountMaximum;    // how many contacts the screen tracks, usually read-only
+} HIDConfigurationLayout;
+
+#define HID_INPUT_MODE_MULTI_INPUT  2
+#define HID_LATENCY_MODE_NORMAL     0
+
+/**
+ Finds the configuration values in the feature reports of the descriptor. Returns false if there are none.
+ */
+bool HIDConfigurationLayoutCompile(const uint8_t *descriptor, size_t length, HIDConfigurationLayout *layout);
+
+
+
+#pragma mark - Reading Values
+
+static inline bool HIDFieldIsPresent(const HIDField *field) {
+    return field->bitSize > 0;
+}
+
+/**
+ Reads a value of up to 32 bits (HID stores values little endian, least significant bit first).
+ */
+static inline int32_t HIDFieldRead(const uint8_t *report, const HIDField *field) {
+    uint32_t byte  = field->bitOffset >> 3;
+    uint32_t shift = field->bitOffset & 7;
+    uint32_t numBytes = (shift + field->bitSize + 7) >> 3;
+
+    uint64_t raw = 0;
+    for (uint32_t i=0; i<numBytes; i++) {
+        raw |= (uint64_t)report[byte + i] << (8 * i);
+    }
+    raw >>= shift;
+
+    uint32_t value = (uint32_t)(raw & ((1ull << field->bitSize) - 1));
+
+    if (field->isSigned && field->bitSize < 32 && (value & (1u << (field->bitSize - 1)))) {
+        value |= ~((1u << field->bitSize) - 1);
+    }
+    return (int32_t)value;
+}
+
+/**
+ Writes a value of up to 32 bits, leaving the surrounding bits of the report as they are.
+ */
+static inline void HIDFieldWrite(uint8_t *report, const HIDField *field, int32_t value) {
+    uint32_t byte  = field->bitOffset >> 3;
+    uint32_t shift = field->bitOffset & 7;
+    uint32_t numBytes = (shift + field->bitSize + 7) >> 3;
+
+    uint64_t mask = ((1ull << field->bitSize) - 1) << shift;
+    uint64_t bits = ((uint64_t)(uint32_t)value << shift) & mask;
+
+    for (uint32_t i=0; i<numBytes; i++) {
+        uint8_t byteMask = (uint8_t)(mask >> (8 * i));
+        report[byte + i] = (report[byte + i] & ~byteMask) | (uint8_t)(bits >> (8 * i));
+    }
+}
+
+#endif /* HIDReportLayout_h */
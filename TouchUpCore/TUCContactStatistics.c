@@ -0,0 +1,290 @@
+//
+//  TUCContactStatistics.c
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "TUCContactStatistics.h"
+
+#include <math.h>
+#include <string.h>
+
+// distances in mm a gesture has to cover before it is recognized
+#define TUC_SCROLL_THRESHOLD    5.0
+#define TUC_PINCH_THRESHOLD     5.0
+#define TUC_ROTATE_THRESHOLD    5.0     // arc length at the fingers
+#define TUC_SWIPE_THRESHOLD     12.0
+
+// a locked pinch also turns, or a locked rotation also scales, once the other component covered this multiple of its threshold
+#define TUC_JOIN_FACTOR         2.0
+
+// mm^2, contacts closer together than this cannot tell scale or rotation
+#define TUC_MIN_TRANSFORM_SPREAD 1.0
+
+
+void TUCContactStatisticsCompute(const TUCContactPoint *contacts, uint32_t count, TUCContactStatistics *statistics) {
+    memset(statistics, 0, sizeof(TUCContactStatistics));
+
+    if (count > TUC_GESTURE_MAX_CONTACTS) {
+        count = TUC_GESTURE_MAX_CONTACTS;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    double sumX = 0, sumY = 0, sumXX = 0, sumYY = 0;
+    uint64_t signature = 0;
+
+    for (uint32_t i=0; i<count; i++) {
+        double x = contacts[i].x;
+        double y = contacts[i].y;
+        sumX  += x;
+        sumY  += y;
+        sumXX += x * x;
+        sumYY += y * y;
+
+        // sum of scrambled IDs, so the order of the contacts does not matter
+        signature += ((uint64_t)contacts[i].contactID + 1) * 0x9E3779B97F4A7C15ull;
+    }
+
+    double n  = (double)count;
+    double cx = sumX / n;
+    double cy = sumY / n;
+
+    double varianceX = sumXX / n - cx * cx;
+    double varianceY = sumYY / n - cy * cy;
+
+    statistics->count     = count;
+    statistics->signature = signature ^ count;
+    statistics->centroidX = cx;
+    statistics->centroidY = cy;
+    statistics->spread    = sqrt(fmax(0, varianceX + varianceY));
+}
+
+
+
+void TUCContactSetInsert(TUCContactPoint *contacts, uint32_t *count, TUCContactPoint contact) {
+    uint32_t i = *count;
+    if (i == TUC_GESTURE_MAX_CONTACTS) {
+        if (contact.contactID >= contacts[i - 1].contactID) {
+            return;
+        }
+        i--;
+    } else {
+        (*count)++;
+    }
+
+    while (i > 0 && contacts[i - 1].contactID > contact.contactID) {
+        contacts[i] = contacts[i - 1];
+        i--;
+    }
+    contacts[i] = contact;
+}
+
+
+
+#pragma mark - Transform
+
+bool TUCSimilarityTransformFit(const TUCContactPoint *previous, uint32_t previousCount,
+                               const TUCContactPoint *current, uint32_t count, TUCSimilarityTransform *transform) {
+    *transform = TUCSimilarityTransformIdentity();
+
+    if (previousCount > TUC_GESTURE_MAX_CONTACTS) {
+        previousCount = TUC_GESTURE_MAX_CONTACTS;
+    }
+    if (count > TUC_GESTURE_MAX_CONTACTS) {
+        count = TUC_GESTURE_MAX_CONTACTS;
+    }
+
+    // sums of the matched pairs, p before and q after
+    double sumPX = 0, sumPY = 0, sumQX = 0, sumQY = 0;
+    double sumPP = 0, sumDot = 0, sumCross = 0;
+    uint32_t n = 0;
+
+    for (uint32_t i=0; i<count; i++) {
+        const TUCContactPoint *q = &current[i];
+        const TUCContactPoint *p = NULL;
+
+        for (uint32_t j=0; j<previousCount; j++) {
+            if (previous[j].contactID == q->contactID) {
+                p = &previous[j];
+                break;
+            }
+        }
+        if (!p) {
+            continue;
+        }
+
+        sumPX    += p->x;
+        sumPY    += p->y;
+        sumQX    += q->x;
+        sumQY    += q->y;
+        sumPP    += p->x * p->x + p->y * p->y;
+        sumDot   += p->x * q->x + p->y * q->y;
+        sumCross += p->x * q->y - p->y * q->x;
+        n++;
+    }
+
+    if (n == 0) {
+        return false;
+    }
+
+    double pcx = sumPX / n, pcy = sumPY / n;
+    double qcx = sumQX / n, qcy = sumQY / n;
+
+    transform->dx = qcx - pcx;
+    transform->dy = qcy - pcy;
+
+    // relative to the centroids, q = (a -b; b a) p minimizes the squared error with
+    // a = sum p.q / sum |p|^2 and b = sum p x q / sum |p|^2
+    double pp    = sumPP    - n * (pcx * pcx + pcy * pcy);
+    double dot   = sumDot   - n * (pcx * qcx + pcy * qcy);
+    double cross = sumCross - n * (pcx * qcy - pcy * qcx);
+
+    if (n < 2 || pp < TUC_MIN_TRANSFORM_SPREAD) {
+        return true;
+    }
+
+    double a = dot / pp;
+    double b = cross / pp;
+    transform->scale    = hypot(a, b);
+    transform->rotation = atan2(b, a);
+    return true;
+}
+
+
+/**
+ Applies `next` after `transform`. Translations of the centroid add up, as the centroid of the same contacts is fitted each time.
+ */
+static void ComposeTransform(TUCSimilarityTransform *transform, const TUCSimilarityTransform *next) {
+    transform->dx       += next->dx;
+    transform->dy       += next->dy;
+    transform->scale    *= next->scale;
+    transform->rotation += next->rotation;
+}
+
+
+
+#pragma mark - Recognition
+
+void TUCMultitouchReset(TUCMultitouchState *state) {
+    memset(state, 0, sizeof(TUCMultitouchState));
+}
+
+
+static void StartContactSet(TUCMultitouchState *state, const TUCContactStatistics *statistics) {
+    state->start      = *statistics;
+    state->total      = TUCSimilarityTransformIdentity();
+    state->sinceLock  = TUCSimilarityTransformIdentity();
+    state->kind       = TUCMultitouchKindNone;
+    state->isScaling  = false;
+    state->isRotating = false;
+}
+
+
+/**
+ Decides the kind from the transform since the contact set was first seen, or returns `TUCMultitouchKindNone` if it is too early.
+ */
+static TUCMultitouchKind RecognizeKind(const TUCMultitouchState *state, double spread) {
+    const TUCSimilarityTransform *total = &state->total;
+    double translation = hypot(total->dx, total->dy);
+
+    if (state->start.count >= 3) {
+        return translation > TUC_SWIPE_THRESHOLD ? TUCMultitouchKindSwipe : TUCMultitouchKindNone;
+    }
+
+    double spreadChange = fabs(total->scale - 1) * state->start.spread;
+    double arc = fabs(total->rotation) * spread;
+
+    // whichever crossed its threshold by the largest margin wins
+    double scrollScore = translation  / TUC_SCROLL_THRESHOLD;
+    double pinchScore  = spreadChange / TUC_PINCH_THRESHOLD;
+    double rotateScore = arc          / TUC_ROTATE_THRESHOLD;
+
+    if (scrollScore >= 1 && scrollScore >= pinchScore && scrollScore >= rotateScore) {
+        return TUCMultitouchKindScroll;
+    } else if (pinchScore >= 1 && pinchScore >= rotateScore) {
+        return TUCMultitouchKindPinch;
+    } else if (rotateScore >= 1) {
+        return TUCMultitouchKindRotate;
+    }
+    return TUCMultitouchKindNone;
+}
+
+
+TUCMultitouchKind TUCMultitouchUpdate(TUCMultitouchState *state, const TUCContactPoint *contacts, uint32_t count,
+                                      TUCSimilarityTransform *delta) {
+    *delta = TUCSimilarityTransformIdentity();
+
+    TUCContactStatistics statistics;
+    TUCContactStatisticsCompute(contacts, count, &statistics);
+    state->current = statistics;
+
+    if (statistics.count < 2) {
+        TUCMultitouchReset(state);
+        return TUCMultitouchKindNone;
+    }
+
+    bool isNewSet = statistics.signature != state->start.signature || statistics.count != state->start.count;
+    if (!isNewSet) {
+        TUCSimilarityTransformFit(state->previous, state->numPrevious, contacts, statistics.count, delta);
+    }
+
+    memcpy(state->previous, contacts, statistics.count * sizeof(TUCContactPoint));
+    state->numPrevious = statistics.count;
+
+    if (isNewSet) {
+        StartContactSet(state, &statistics);
+        return TUCMultitouchKindNone;
+    }
+
+    ComposeTransform(&state->total, delta);
+
+    if (state->kind == TUCMultitouchKindNone) {
+        state->kind       = RecognizeKind(state, statistics.spread);
+        state->isScaling  = state->kind == TUCMultitouchKindPinch;
+        state->isRotating = state->kind == TUCMultitouchKindRotate;
+
+        // the first event carries everything since the set began, so the content does not lag behind the fingers
+        if (state->isScaling) {
+            delta->scale = state->total.scale;
+        }
+        if (state->isRotating) {
+            delta->rotation = state->total.rotation;
+        }
+
+    } else if (state->kind == TUCMultitouchKindPinch || state->kind == TUCMultitouchKindRotate) {
+        ComposeTransform(&state->sinceLock, delta);
+
+        // the other component joins late and on a larger distance, so it cannot flicker in and out
+        if (!state->isRotating && fabs(state->sinceLock.rotation) * statistics.spread > TUC_JOIN_FACTOR * TUC_ROTATE_THRESHOLD) {
+            state->isRotating = true;
+        }
+        if (!state->isScaling && fabs(state->sinceLock.scale - 1) * statistics.spread > TUC_JOIN_FACTOR * TUC_PINCH_THRESHOLD) {
+            state->isScaling = true;
+        }
+    }
+
+    if (!state->isScaling) {
+        delta->scale = 1;
+    }
+    if (!state->isRotating) {
+        delta->rotation = 0;
+    }
+    return state->kind;
+}
+
+
+void TUCMultitouchSwipeDirection(const TUCMultitouchState *state, int *dx, int *dy) {
+    double x = state->total.dx;
+    double y = state->total.dy;
+
+    *dx = 0;
+    *dy = 0;
+    if (fabs(x) >= fabs(y)) {
+        *dx = x < 0 ? -1 : 1;
+    } else {
+        *dy = y < 0 ? -1 : 1;
+    }
+}
@@ -0,0 +1,119 @@
+//
+//  TUCContactStatistics.h
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef TUCContactStatistics_h
+#define TUCContactStatistics_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ Multi-finger gestures are recognized from all contacts of a frame instead of comparing single touches: a few statistics
+ identify the set of contacts, and a least squares fit tells how the set moved, scaled and turned since the previous frame.
+ Both are sums collected in one pass, and at most `TUC_GESTURE_MAX_CONTACTS` contacts are considered,
+ so the cost per frame is bounded no matter how many fingers are down.
+ */
+
+#define TUC_GESTURE_MAX_CONTACTS 10
+
+typedef struct {
+    int64_t contactID;
+    double  x;              // mm, in screen orientation
+    double  y;
+} TUCContactPoint;
+
+
+typedef struct {
+    uint32_t count;
+    uint64_t signature;     // identifies the set of contacts, independent of their order
+    double   centroidX;     // mm
+    double   centroidY;
+    double   spread;        // root mean square distance from the centroid, mm
+} TUCContactStatistics;
+
+
+void TUCContactStatisticsCompute(const TUCContactPoint *contacts, uint32_t count, TUCContactStatistics *statistics);
+
+/**
+ Adds a contact to `contacts`, which holds at most `TUC_GESTURE_MAX_CONTACTS` contacts sorted by ID. Once it is full, only the
+ contacts with the lowest IDs are kept, so with more fingers down the same ones are considered in every frame.
+ */
+void TUCContactSetInsert(TUCContactPoint *contacts, uint32_t *count, TUCContactPoint contact);
+
+
+
+#pragma mark - Transform
+
+/**
+ Maps contacts onto their later positions: moves the centroid by (dx, dy), then scales and turns around it.
+ */
+typedef struct {
+    double dx;              // centroid, mm
+    double dy;
+    double scale;           // 1 if the spread did not change
+    double rotation;        // radians, positive turns from x towards y, which is clockwise in screen orientation
+} TUCSimilarityTransform;
+
+
+static inline TUCSimilarityTransform TUCSimilarityTransformIdentity(void) {
+    return (TUCSimilarityTransform){ 0, 0, 1, 0 };
+}
+
+/**
+ Fits the similarity transform that maps the `previous` contacts onto `current` with the least squared error.
+ Contacts are matched by their ID, unmatched ones are ignored. Scale and rotation need two matched contacts that are
+ apart, otherwise they stay 1 and 0 and only the centroid moves. Returns false if no contact matched at all.
+ */
+bool TUCSimilarityTransformFit(const TUCContactPoint *previous, uint32_t previousCount,
+                               const TUCContactPoint *current, uint32_t count, TUCSimilarityTransform *transform);
+
+
+
+#pragma mark - Recognition
+
+typedef enum {
+    TUCMultitouchKindNone,      // not decided yet
+    TUCMultitouchKindScroll,    // two fingers moving together
+    TUCMultitouchKindPinch,
+    TUCMultitouchKindRotate,
+    TUCMultitouchKindSwipe      // three or more fingers
+} TUCMultitouchKind;
+
+
+typedef struct {
+    TUCContactStatistics   start;       // when the current set of contacts was first seen
+    TUCContactStatistics   current;     // of the latest frame, its centroid is the anchor of a pinch or rotation
+    TUCContactPoint        previous[TUC_GESTURE_MAX_CONTACTS];
+    uint32_t               numPrevious;
+    TUCSimilarityTransform total;       // since the set of contacts was first seen
+    TUCSimilarityTransform sinceLock;   // since the kind was recognized
+    TUCMultitouchKind      kind;
+    bool                   isScaling;   // the scale of a rotation is passed on
+    bool                   isRotating;  // the rotation of a pinch is passed on
+} TUCMultitouchState;
+
+
+/**
+ Feeds the contacts of a new frame into the state and returns their transform since the previous frame in `delta`.
+ A new set of contacts starts over with `TUCMultitouchKindNone`. Once a kind is recognized, it stays until the set of contacts changes.
+
+ Scale and rotation are only passed on for the kind that was recognized, so an imprecise pinch does not turn the content.
+ The frame that recognizes a pinch or rotation returns the scale or rotation since the set began, so it starts without a jump.
+ If the fingers clearly do both, the other component joins once it covered twice its own threshold after the kind was locked.
+ Scrolls and swipes never scale or turn.
+ */
+TUCMultitouchKind TUCMultitouchUpdate(TUCMultitouchState *state, const TUCContactPoint *contacts, uint32_t count,
+                                      TUCSimilarityTransform *delta);
+
+void TUCMultitouchReset(TUCMultitouchState *state);
+
+/**
+ Direction of a swipe from the start of the contact set: (+-1, 0) or (0, +-1), y pointing down like screen coordinates.
+ */
+void TUCMultitouchSwipeDirection(const TUCMultitouchState *state, int *dx, int *dy);
+
+#endif /* TUCContactStatistics_h */
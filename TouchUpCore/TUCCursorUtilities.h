@@ -29,11 +29,61 @@ NS_ASSUME_NONNULL_BEGIN
 - (void)dragCursorTo:(CGPoint)aLocation phase:(NSTouchPhase)phase;
 - (void)stopDraggingCursor;
 
+
+/**
+ A speculative press puts the left button down before the finger lifted or moved. It ends as a click, turns into a drag,
+ or is cancelled: then the button is released where it was pressed, which the pressed control may take as a click.
+ Stopping a drag while a speculative press is pending cancels it.
+ */
+@property (readonly) BOOL isPressingSpeculatively;
+
+- (void)beginSpeculativePressAt:(CGPoint)aLocation;
+- (void)commitSpeculativePressAsClickAt:(CGPoint)aLocation;
+- (void)commitSpeculativePressAsDrag;
+- (void)cancelSpeculativePress;
+
 - (void)scroll:(CGPoint)translation phase:(NSTouchPhase)phase;
 
-- (void)magnifyLocationA:(CGPoint)p1 locationB:(CGPoint)p2 relativeP1:(CGPoint)r1 relP2:(CGPoint)r2;
+/**
+ Like `scroll:phase:`, but when the phase ends, momentum starts with `velocity` (points per second) instead of the last translation.
+ */
+- (void)scroll:(CGPoint)translation phase:(NSTouchPhase)phase velocity:(CGPoint)velocity;
+
+/**
+ Momentum scrolling keeps a timer running after the finger lifted. The handler is called on the main thread when it stops.
+ */
+@property (readonly) BOOL isMomentumScrolling;
+@property (copy, nullable) void (^momentumScrollDidStop)(void);
+
+/**
+ magnification since the last call, 0.01 enlarges by one percent. The first call moves the cursor to `aLocation`.
+ Changes too small to see are collected until they add up to a visible step.
+ */
+- (void)magnifyBy:(CGFloat)magnification around:(CGPoint)aLocation;
 - (void)stopMagnifying;
 
+/**
+ rotation in degrees since the last call, counterclockwise positive. Collected like the magnification.
+ */
+- (void)rotateBy:(CGFloat)rotation around:(CGPoint)aLocation;
+- (void)stopRotating;
+
+/**
+ Direction of the fingers, (+-1, 0) or (0, +-1) with y pointing down.
+ */
+- (void)navigateHistoryInDirection:(CGPoint)direction;
+- (void)switchSpaceInDirection:(CGPoint)direction;
+
+
+/**
+ Pen input is posted as tablet events with pressure and tilt: proximity events when the pen enters and leaves the range,
+ mouse moves while it hovers and left mouse drags while the tip touches (right mouse drags if the barrel switch was held when it touched down).
+ Called from the pen thread only, the pen has its own button state and does not interfere with touch drags.
+ Tilt is -1...1 in screen orientation.
+ */
+- (void)updatePenAt:(CGPoint)aLocation pressure:(CGFloat)pressure tilt:(CGPoint)tilt
+            inRange:(BOOL)isInRange tipDown:(BOOL)isTipDown barrelSwitch:(BOOL)isBarrelPressed eraser:(BOOL)isEraser;
+
 
 @end
 
@@ -6,6 +6,18 @@
 //
 
 #import "TUCCursorUtilities.h"
+#import "TUCTrace.h"
+
+#import <Carbon/Carbon.h>
+#import <IOKit/hidsystem/IOLLEvent.h>
+
+#define TUC_PEN_DEVICE_ID 0x5455 // identifies our pen in tablet events
+
+#define TUC_MOMENTUM_SCROLL_INTERVAL 0.01
+
+// smaller steps are collected, posting them would only cost redraws without visible change
+#define TUC_MIN_VISIBLE_MAGNIFICATION   0.005
+#define TUC_MIN_VISIBLE_ROTATION        0.25    // degrees
 
 @interface TUCCursorUtilities ()
 
@@ -15,11 +27,24 @@
 
 @property BOOL isLeftMouseDown;
 
+@property (readwrite) BOOL isPressingSpeculatively;
+@property uint64_t speculativePressTime;    // ns, CLOCK_UPTIME_RAW
+@property CGPoint speculativePressLocation;
+
 @property CGPoint momentumScrollTranslation;
 @property (strong) NSTimer *momentumScrollTimer;
 
 @property BOOL isMagnifying;
-@property CGFloat lastPinchDistance;
+@property CGFloat pendingMagnification;
+
+@property BOOL isRotating;
+@property CGFloat pendingRotation; // degrees
+
+// pen thread only
+@property (nonatomic) BOOL isPenInProximity;
+@property (nonatomic) BOOL isPenEraser;
+@property (nonatomic) BOOL isPenDown;
+@property (nonatomic) CGMouseButton penButton;
 
 @end
 
@@ -155,6 +180,11 @@
 
 
 - (void)stopDraggingCursor {
+    if (self.isPressingSpeculatively) {
+        [self cancelSpeculativePress];
+        return;
+    }
+    
     if (self.isLeftMouseDown) {
         CGEventRef event = CGEventCreateMouseEvent(NULL, kCGEventLeftMouseUp, [self currentCursorLocation], kCGMouseButtonLeft);
         CGEventSetIntegerValueField(event, kCGMouseEventClickState, self.cursorClickCount);
@@ -167,6 +197,82 @@
 
 
 
+- (void)beginSpeculativePressAt:(CGPoint)aLocation {
+    if (self.isLeftMouseDown) {
+        return;
+    }
+    
+    [self updateCursorClickCountWithLocation:aLocation];
+    
+    CGEventRef event = CGEventCreateMouseEvent(NULL, kCGEventLeftMouseDown, aLocation, kCGMouseButtonLeft);
+    CGEventSetIntegerValueField(event, kCGMouseEventClickState, self.cursorClickCount);
+    CGEventPost(kCGHIDEventTap, event);
+    CFRelease(event);
+    
+    self.isLeftMouseDown = YES;
+    self.isPressingSpeculatively = YES;
+    self.speculativePressTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    self.speculativePressLocation = aLocation;
+    
+    TUCTrace(TUCTraceLevelInfo, TUCTraceEventSpeculativePress, TUCTracePressBegan, 0, 0, 0);
+}
+
+
+- (void)finishSpeculativePress:(TUCTracePressOutcome)outcome {
+    self.isPressingSpeculatively = NO;
+    
+    uint64_t heldNs = clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - self.speculativePressTime;
+    TUCTrace(TUCTraceLevelInfo, TUCTraceEventSpeculativePress, outcome, heldNs, 0, 0);
+}
+
+
+- (void)commitSpeculativePressAsClickAt:(CGPoint)aLocation {
+    if (!self.isPressingSpeculatively) {
+        return;
+    }
+    
+    CGEventRef event = CGEventCreateMouseEvent(NULL, kCGEventLeftMouseUp, aLocation, kCGMouseButtonLeft);
+    CGEventSetIntegerValueField(event, kCGMouseEventClickState, self.cursorClickCount);
+    CGEventPost(kCGHIDEventTap, event);
+    CFRelease(event);
+    
+    self.isLeftMouseDown = NO;
+    self.timeOfLastClick = [NSDate date];
+    self.locationOfLastClick = aLocation;
+    
+    [self finishSpeculativePress:TUCTracePressClicked];
+}
+
+
+- (void)commitSpeculativePressAsDrag {
+    if (!self.isPressingSpeculatively) {
+        return;
+    }
+    
+    // the button stays down, dragCursorTo:phase: continues from here
+    [self finishSpeculativePress:TUCTracePressDragged];
+}
+
+
+- (void)cancelSpeculativePress {
+    if (!self.isPressingSpeculatively) {
+        return;
+    }
+    
+    // there is no location that is safe to release the button at without a click, so it is released where it was pressed
+    CGEventRef event = CGEventCreateMouseEvent(NULL, kCGEventLeftMouseUp, self.speculativePressLocation, kCGMouseButtonLeft);
+    CGEventSetIntegerValueField(event, kCGMouseEventClickState, self.cursorClickCount);
+    CGEventPost(kCGHIDEventTap, event);
+    CFRelease(event);
+    
+    self.isLeftMouseDown = NO;
+    self.cursorClickCount = 0;
+    
+    [self finishSpeculativePress:TUCTracePressCancelled];
+}
+
+
+
 - (void)scroll:(CGPoint)translation phase:(NSTouchPhase)phase {
     [self stopDraggingCursor];
     
@@ -179,7 +285,8 @@
         // TODO: consider sampling rate of digitizer and screen refresh rate
         [self cancelMomentumScroll];
         
-        self.momentumScrollTimer = [NSTimer scheduledTimerWithTimeInterval:0.01 target:self selector:@selector(updateMomentumScroll) userInfo:nil repeats:YES];
+        self.momentumScrollTimer = [NSTimer scheduledTimerWithTimeInterval:TUC_MOMENTUM_SCROLL_INTERVAL target:self selector:@selector(updateMomentumScroll) userInfo:nil repeats:YES];
+        self.momentumScrollTimer.tolerance = 0.002;
     } else {
         self.momentumScrollTranslation = translation;
     }
@@ -187,6 +294,16 @@
 
 
 
+- (void)scroll:(CGPoint)translation phase:(NSTouchPhase)phase velocity:(CGPoint)velocity {
+    if (phase == NSTouchPhaseEnded) {
+        self.momentumScrollTranslation = CGPointMake(velocity.x * TUC_MOMENTUM_SCROLL_INTERVAL,
+                                                     velocity.y * TUC_MOMENTUM_SCROLL_INTERVAL);
+    }
+    [self scroll:translation phase:phase];
+}
+
+
+
 - (void)updateMomentumScroll {
     self.momentumScrollTranslation = CGPointMake(self.momentumScrollTranslation.x * 0.985,
                                                  self.momentumScrollTranslation.y * 0.985);
@@ -204,10 +321,19 @@
     if (self.momentumScrollTimer != nil) {
         [self.momentumScrollTimer invalidate];
         self.momentumScrollTimer = nil;
+        
+        if (self.momentumScrollDidStop) {
+            self.momentumScrollDidStop();
+        }
     }
 }
 
 
+- (BOOL)isMomentumScrolling {
+    return self.momentumScrollTimer != nil;
+}
+
+
 - (void)magnify:(CGFloat)magnification phase:(NSTouchPhase)phase {
     [self stopDraggingCursor];
     
@@ -248,28 +374,20 @@
 }
 
 
-- (void)magnifyLocationA:(CGPoint)p1 locationB:(CGPoint)p2 relativeP1:(CGPoint)r1 relP2:(CGPoint)r2 {
-    [self stopDraggingCursor];
-    
-    NSTouchPhase phase = NSTouchPhaseMoved;
-    
-    CGFloat dx = r1.x - r2.x;
-    CGFloat dy = r1.y - r2.y;
-    
-    CGFloat distance = sqrt( pow(dx, 2) + pow(dy, 2) );
-    CGFloat delta = distance - self.lastPinchDistance;
-    
-    self.lastPinchDistance = distance;
-    
+- (void)magnifyBy:(CGFloat)magnification around:(CGPoint)aLocation {
     if (!self.isMagnifying) {
-        CGPoint middle = CGPointMake(0.5f * (p1.x + p2.x), 0.5f * (p1.y + p2.y));
-        [self moveCursorTo:middle];
-        phase = NSTouchPhaseBegan;
-        delta = 0;
+        [self moveCursorTo:aLocation];
+        [self magnify:0 phase:NSTouchPhaseBegan];
+        self.pendingMagnification = 0;
         self.isMagnifying = YES;
     }
     
-    [self magnify:delta * 4 phase:phase];
+    self.pendingMagnification += magnification;
+    
+    if (fabs(self.pendingMagnification) >= TUC_MIN_VISIBLE_MAGNIFICATION) {
+        [self magnify:self.pendingMagnification phase:NSTouchPhaseMoved];
+        self.pendingMagnification = 0;
+    }
 }
 
 
@@ -280,4 +398,171 @@
     }
 }
 
+
+
+- (void)rotate:(CGFloat)rotation phase:(NSTouchPhase)phase {
+    [self stopDraggingCursor];
+    
+    if (phase == NSTouchPhaseMoved && rotation == 0) {
+        return;
+    }
+    
+    // same gesture event as magnify, with the rotation subtype
+    CGEventRef event = CGEventCreateMouseEvent(NULL, kCGEventMouseMoved, [self currentCursorLocation], kCGMouseButtonLeft);
+    
+    CGEventSetType(event, 29); // type gesture
+    CGEventSetFlags(event, 0);
+    
+    CGEventSetDoubleValueField(event, 114, rotation);
+    
+    CGEventSetIntegerValueField(event, 50, 248);
+    CGEventSetIntegerValueField(event, 101, 4);
+    CGEventSetIntegerValueField(event, 110, 5);
+    
+    CGEventSetIntegerValueField(event, 132, phase);
+    
+    CGEventPost(kCGHIDEventTap, event);
+    CFRelease(event);
+}
+
+
+- (void)rotateBy:(CGFloat)rotation around:(CGPoint)aLocation {
+    if (!self.isRotating) {
+        [self moveCursorTo:aLocation];
+        [self rotate:0 phase:NSTouchPhaseBegan];
+        self.pendingRotation = 0;
+        self.isRotating = YES;
+    }
+    
+    self.pendingRotation += rotation;
+    
+    if (fabs(self.pendingRotation) >= TUC_MIN_VISIBLE_ROTATION) {
+        [self rotate:self.pendingRotation phase:NSTouchPhaseMoved];
+        self.pendingRotation = 0;
+    }
+}
+
+
+- (void)stopRotating {
+    if (self.isRotating) {
+        self.isRotating = NO;
+        [self rotate:0 phase:NSTouchPhaseEnded];
+    }
+}
+
+
+
+- (void)postKey:(CGKeyCode)key flags:(CGEventFlags)flags {
+    CGEventRef event = CGEventCreateKeyboardEvent(NULL, key, true);
+    CGEventSetFlags(event, flags);
+    CGEventPost(kCGHIDEventTap, event);
+    
+    CGEventSetType(event, kCGEventKeyUp);
+    CGEventPost(kCGHIDEventTap, event);
+    CFRelease(event);
+}
+
+
+- (void)navigateHistoryInDirection:(CGPoint)direction {
+    // fingers moving right go back, like on the trackpad
+    if (direction.x > 0) {
+        [self postKey:kVK_ANSI_LeftBracket flags:kCGEventFlagMaskCommand];
+    } else if (direction.x < 0) {
+        [self postKey:kVK_ANSI_RightBracket flags:kCGEventFlagMaskCommand];
+    }
+}
+
+
+- (void)switchSpaceInDirection:(CGPoint)direction {
+    if (direction.x > 0) {
+        [self postKey:kVK_LeftArrow flags:kCGEventFlagMaskControl];
+    } else if (direction.x < 0) {
+        [self postKey:kVK_RightArrow flags:kCGEventFlagMaskControl];
+    } else if (direction.y < 0) {
+        [self postKey:kVK_UpArrow flags:kCGEventFlagMaskControl];     // Mission Control
+    } else if (direction.y > 0) {
+        [self postKey:kVK_DownArrow flags:kCGEventFlagMaskControl];   // App Exposé
+    }
+}
+
+
+
+
+- (void)postPenProximity:(BOOL)isEntering eraser:(BOOL)isEraser {
+    CGEventRef event = CGEventCreate(NULL);
+    CGEventSetType(event, kCGEventTabletProximity);
+    
+    CGEventSetIntegerValueField(event, kCGTabletProximityEventDeviceID, TUC_PEN_DEVICE_ID);
+    CGEventSetIntegerValueField(event, kCGTabletProximityEventPointerType,
+                                isEraser ? NSPointingDeviceTypeEraser : NSPointingDeviceTypePen);
+    CGEventSetIntegerValueField(event, kCGTabletProximityEventCapabilityMask,
+                                NX_TABLET_CAPABILITY_DEVICEIDMASK | NX_TABLET_CAPABILITY_ABSXMASK | NX_TABLET_CAPABILITY_ABSYMASK
+                                | NX_TABLET_CAPABILITY_BUTTONSMASK | NX_TABLET_CAPABILITY_TILTXMASK | NX_TABLET_CAPABILITY_TILTYMASK
+                                | NX_TABLET_CAPABILITY_PRESSUREMASK);
+    CGEventSetIntegerValueField(event, kCGTabletProximityEventEnterProximity, isEntering);
+    
+    CGEventPost(kCGHIDEventTap, event);
+    CFRelease(event);
+}
+
+
+- (void)postPenEvent:(CGEventType)type at:(CGPoint)aLocation button:(CGMouseButton)button pressure:(CGFloat)pressure tilt:(CGPoint)tilt {
+    CGEventRef event = CGEventCreateMouseEvent(NULL, type, aLocation, button);
+    
+    CGEventSetIntegerValueField(event, kCGMouseEventSubtype, kCGEventMouseSubtypeTabletPoint);
+    CGEventSetDoubleValueField(event, kCGMouseEventPressure, pressure);
+    CGEventSetIntegerValueField(event, kCGTabletEventDeviceID, TUC_PEN_DEVICE_ID);
+    CGEventSetDoubleValueField(event, kCGTabletEventPointPressure, pressure);
+    CGEventSetDoubleValueField(event, kCGTabletEventTiltX, tilt.x);
+    CGEventSetDoubleValueField(event, kCGTabletEventTiltY, tilt.y);
+    
+    CGEventPost(kCGHIDEventTap, event);
+    CFRelease(event);
+}
+
+
+- (void)updatePenAt:(CGPoint)aLocation pressure:(CGFloat)pressure tilt:(CGPoint)tilt
+            inRange:(BOOL)isInRange tipDown:(BOOL)isTipDown barrelSwitch:(BOOL)isBarrelPressed eraser:(BOOL)isEraser {
+    
+    BOOL isRightButton = self.penButton == kCGMouseButtonRight;
+    
+    // lift the tip before leaving, and before switching between pen and eraser
+    if (self.isPenDown && (!isTipDown || !isInRange || isEraser != self.isPenEraser)) {
+        [self postPenEvent:isRightButton ? kCGEventRightMouseUp : kCGEventLeftMouseUp
+                        at:aLocation button:self.penButton pressure:0 tilt:tilt];
+        self.isPenDown = NO;
+    }
+    
+    if (self.isPenInProximity && (!isInRange || isEraser != self.isPenEraser)) {
+        [self postPenProximity:NO eraser:self.isPenEraser];
+        self.isPenInProximity = NO;
+    }
+    
+    if (!isInRange) {
+        return;
+    }
+    
+    if (!self.isPenInProximity) {
+        [self postPenProximity:YES eraser:isEraser];
+        self.isPenInProximity = YES;
+        self.isPenEraser = isEraser;
+    }
+    
+    if (isTipDown && !self.isPenDown) {
+        self.penButton = isBarrelPressed ? kCGMouseButtonRight : kCGMouseButtonLeft;
+        isRightButton = self.penButton == kCGMouseButtonRight;
+        
+        [self postPenEvent:isRightButton ? kCGEventRightMouseDown : kCGEventLeftMouseDown
+                        at:aLocation button:self.penButton pressure:pressure tilt:tilt];
+        self.isPenDown = YES;
+        
+    } else if (isTipDown) {
+        [self postPenEvent:isRightButton ? kCGEventRightMouseDragged : kCGEventLeftMouseDragged
+                        at:aLocation button:self.penButton pressure:pressure tilt:tilt];
+        
+    } else {
+        [self postPenEvent:kCGEventMouseMoved at:aLocation button:kCGMouseButtonLeft pressure:0 tilt:tilt];
+    }
+}
+
 @end
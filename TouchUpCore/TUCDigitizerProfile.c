@@ -0,0 +1,90 @@
+//
+//  TUCDigitizerProfile.c
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "TUCDigitizerProfile.h"
+#include "TUCMotionHistory.h"
+
+#include <math.h>
+#include <string.h>
+
+#define PROFILE_SMOOTHING           0.02    // weight of a new sample once the estimate is running
+#define PROFILE_MIN_INTERVAL        0.0005  // s, reports closer than this belong to the same scan
+#define PROFILE_MAX_INTERVAL        0.1     // s, anything longer is a pause
+#define PROFILE_MAX_INTERVAL_RATIO  3       // once measured, longer gaps are stalls or lost reports
+#define PROFILE_MAX_JITTER_RATIO    4       // once measured, one jittery contact moves the noise estimate at most this far
+
+
+/**
+ Exponentially weighted average that is a plain average for the first samples, so it settles quickly after a connect.
+ */
+static double Smooth(double estimate, double sample, uint32_t numSamples) {
+    double weight = fmax(1.0 / numSamples, PROFILE_SMOOTHING);
+    return estimate + weight * (sample - estimate);
+}
+
+
+void TUCDigitizerProfileReset(TUCDigitizerProfile *profile) {
+    memset(profile, 0, sizeof(TUCDigitizerProfile));
+}
+
+
+bool TUCDigitizerProfileAddReport(TUCDigitizerProfile *profile, double timestamp) {
+    double interval = timestamp - profile->lastReport;
+    profile->lastReport = timestamp;
+
+    if (interval < PROFILE_MIN_INTERVAL || interval > PROFILE_MAX_INTERVAL) {
+        return false;
+    }
+    if (TUCDigitizerProfileIsSettled(profile) && interval > PROFILE_MAX_INTERVAL_RATIO * profile->reportInterval) {
+        return false;
+    }
+
+    if (profile->numIntervals < UINT32_MAX) {
+        profile->numIntervals++;
+    }
+    profile->reportInterval = Smooth(profile->reportInterval, interval, profile->numIntervals);
+
+    return profile->numIntervals == TUC_PROFILE_SETTLED_REPORTS;
+}
+
+
+void TUCDigitizerProfileAddJitter(TUCDigitizerProfile *profile, double jitter) {
+    if (profile->numNoiseSamples >= TUC_PROFILE_SETTLED_REPORTS) {
+        jitter = fmin(jitter, PROFILE_MAX_JITTER_RATIO * profile->noise);
+    }
+
+    if (profile->numNoiseSamples < UINT32_MAX) {
+        profile->numNoiseSamples++;
+    }
+    profile->noise = Smooth(profile->noise, jitter, profile->numNoiseSamples);
+}
+
+
+double TUCDigitizerProfileReportRate(const TUCDigitizerProfile *profile) {
+    return profile->reportInterval > 0 ? 1 / profile->reportInterval : 0;
+}
+
+
+double TUCDigitizerProfileVelocityWindow(const TUCDigitizerProfile *profile) {
+    // half an interval of slack, so timestamp jitter cannot push the oldest report out of the window
+    return fmax(TUC_MOTION_VELOCITY_WINDOW, (TUC_PROFILE_MIN_VELOCITY_SAMPLES - 0.5) * profile->reportInterval);
+}
+
+
+double TUCDigitizerProfileStationarySpeed(const TUCDigitizerProfile *profile) {
+    double interval = profile->reportInterval;
+    if (interval <= 0 || profile->numNoiseSamples == 0) {
+        return TUC_STATIONARY_SPEED;
+    }
+
+    // standard deviation of the slope of a line fit through n evenly spaced samples with noise sigma:
+    // sigma / sqrt(sum (t - mean t)^2), and the sum is interval^2 * n (n^2 - 1) / 12
+    double n = floor(TUCDigitizerProfileVelocityWindow(profile) / interval + 1e-6) + 1;
+    double speedNoise = profile->noise / (interval * sqrt(n * (n * n - 1) / 12));
+
+    return fmin(fmax(TUC_STATIONARY_NOISE_MARGIN * speedNoise, TUC_STATIONARY_SPEED), TUC_STATIONARY_SPEED_MAX);
+}
@@ -0,0 +1,70 @@
+//
+//  TUCDigitizerProfile.h
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef TUCDigitizerProfile_h
+#define TUCDigitizerProfile_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ Report rate and noise floor of the connected digitizer, measured from the reports themselves. The estimates start over when a
+ screen connects and keep following the device afterwards, so motion thresholds can be given in mm/s and seconds and still
+ behave the same on a 60 Hz panel with coarse coordinates and on a fast, precise one.
+ */
+
+#define TUC_STATIONARY_SPEED        10      // mm/s, slower touches are stationary on a noiseless screen
+#define TUC_STATIONARY_SPEED_MAX    40      // mm/s, a noisy screen never raises the threshold beyond this
+#define TUC_STATIONARY_NOISE_MARGIN 3       // multiple of the speed a resting finger seems to have because of noise
+
+#define TUC_PROFILE_MIN_VELOCITY_SAMPLES 4  // the velocity window is widened on slow screens to contain this many reports
+#define TUC_PROFILE_SETTLED_REPORTS      64 // intervals measured before the estimate is considered reliable
+
+
+typedef struct {
+    double   reportInterval;    // s, smoothed time between two reports; 0 until measured
+    double   noise;             // mm, smoothed deviation of resting contacts from a straight line; 0 until measured
+    double   lastReport;        // s, timestamp of the previous report
+    uint32_t numIntervals;
+    uint32_t numNoiseSamples;
+} TUCDigitizerProfile;
+
+
+void TUCDigitizerProfileReset(TUCDigitizerProfile *profile);
+
+/**
+ Call once per report. Gaps longer than a few report intervals are pauses of the user or stalls, they are not counted.
+ Returns true when the estimate just became reliable.
+ */
+bool TUCDigitizerProfileAddReport(TUCDigitizerProfile *profile, double timestamp);
+
+/**
+ `jitter` is the deviation of a resting contact from its fitted line in mm, see `TUCMotionHistoryJitter`.
+ */
+void TUCDigitizerProfileAddJitter(TUCDigitizerProfile *profile, double jitter);
+
+static inline bool TUCDigitizerProfileIsSettled(const TUCDigitizerProfile *profile) {
+    return profile->numIntervals >= TUC_PROFILE_SETTLED_REPORTS;
+}
+
+/**
+ Reports per second, 0 until measured.
+ */
+double TUCDigitizerProfileReportRate(const TUCDigitizerProfile *profile);
+
+/**
+ Time window for velocity estimates in seconds: `TUC_MOTION_VELOCITY_WINDOW`, or longer if the screen reports too slowly to fill it.
+ */
+double TUCDigitizerProfileVelocityWindow(const TUCDigitizerProfile *profile);
+
+/**
+ Speed in mm/s below which a touch is stationary: `TUC_STATIONARY_SPEED`, raised to stay clear of the speed that noise
+ alone produces in a velocity fit over `TUCDigitizerProfileVelocityWindow`.
+ */
+double TUCDigitizerProfileStationarySpeed(const TUCDigitizerProfile *profile);
+
+#endif /* TUCDigitizerProfile_h */
@@ -0,0 +1,33 @@
+//
+//  TUCFrameStageStatistics.h
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ Time spent in one stage of the frame pipeline, since the manager was started or the timings were reset.
+ */
+@interface TUCFrameStageStatistics : NSObject
+
+@property (readonly, copy) NSString *name;
+@property (readonly) BOOL isEnabled;
+
+@property (readonly) uint64_t frames;
+@property (readonly) NSTimeInterval averageDuration;
+@property (readonly) NSTimeInterval maxDuration;
+
+
+- (instancetype)initWithName:(NSString *)name
+                     enabled:(BOOL)isEnabled
+                      frames:(uint64_t)frames
+             averageDuration:(NSTimeInterval)averageDuration
+                 maxDuration:(NSTimeInterval)maxDuration;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,33 @@
+//
+//  TUCFrameStageStatistics.m
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#import "TUCFrameStageStatistics.h"
+
+@implementation TUCFrameStageStatistics
+
+- (instancetype)initWithName:(NSString *)name
+                     enabled:(BOOL)isEnabled
+                      frames:(uint64_t)frames
+             averageDuration:(NSTimeInterval)averageDuration
+                 maxDuration:(NSTimeInterval)maxDuration {
+    if (self = [super init]) {
+        _name            = [name copy];
+        _isEnabled       = isEnabled;
+        _frames          = frames;
+        _averageDuration = averageDuration;
+        _maxDuration     = maxDuration;
+    }
+    return self;
+}
+
+
+- (NSString *)debugDescription {
+    return [NSString stringWithFormat:@"%@%@: %llu frames, average %.2f us, max %.2f us", self.name, self.isEnabled ? @"" : @" (disabled)",
+            self.frames, self.averageDuration * 1e6, self.maxDuration * 1e6];
+}
+
+@end
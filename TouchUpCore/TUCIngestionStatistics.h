@@ -0,0 +1,45 @@
+//
+//  TUCIngestionStatistics.h
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ How the touch reports of the device were taken in. When the main thread stalls, reports pile up; once it runs again, reports that only
+ moved contacts are merged into the newest one so the cursor jumps to the finger instead of replaying the way.
+ Counted since the manager was started or the statistics were reset.
+ */
+@interface TUCIngestionStatistics : NSObject
+
+@property (readonly) uint64_t reports;
+@property (readonly) uint64_t dispatchedReports;
+
+/**
+ Reports that arrived while ingestion was behind and were folded into a newer one. Reports that begin or end a contact are never merged.
+ */
+@property (readonly) uint64_t mergedReports;
+
+/**
+ Reports the device sent that never arrived, detected from gaps in the scan time.
+ */
+@property (readonly) uint64_t droppedReports;
+
+@property (readonly) uint64_t maxBacklog;
+@property (readonly) NSTimeInterval maxLag;
+
+
+- (instancetype)initWithReports:(uint64_t)reports
+                     dispatched:(uint64_t)dispatchedReports
+                         merged:(uint64_t)mergedReports
+                        dropped:(uint64_t)droppedReports
+                     maxBacklog:(uint64_t)maxBacklog
+                         maxLag:(NSTimeInterval)maxLag;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,35 @@
+//
+//  TUCIngestionStatistics.m
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#import "TUCIngestionStatistics.h"
+
+@implementation TUCIngestionStatistics
+
+- (instancetype)initWithReports:(uint64_t)reports
+                     dispatched:(uint64_t)dispatchedReports
+                         merged:(uint64_t)mergedReports
+                        dropped:(uint64_t)droppedReports
+                     maxBacklog:(uint64_t)maxBacklog
+                         maxLag:(NSTimeInterval)maxLag {
+    if (self = [super init]) {
+        _reports           = reports;
+        _dispatchedReports = dispatchedReports;
+        _mergedReports     = mergedReports;
+        _droppedReports    = droppedReports;
+        _maxBacklog        = maxBacklog;
+        _maxLag            = maxLag;
+    }
+    return self;
+}
+
+
+- (NSString *)debugDescription {
+    return [NSString stringWithFormat:@"%llu reports: %llu dispatched, %llu merged, %llu dropped; max backlog %llu, max lag %.1f ms",
+            self.reports, self.dispatchedReports, self.mergedReports, self.droppedReports, self.maxBacklog, self.maxLag * 1000];
+}
+
+@end
@@ -0,0 +1,158 @@
+//
+//  TUCMotionHistory.c
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "TUCMotionHistory.h"
+
+#include <math.h>
+#include <string.h>
+
+void TUCMotionHistoryReset(TUCMotionHistory *history) {
+    memset(history, 0, sizeof(TUCMotionHistory));
+}
+
+
+void TUCMotionHistoryAppend(TUCMotionHistory *history, double timestamp, CGPoint location) {
+    if (history->count > 0) {
+        uint32_t newest = (history->start + history->count - 1) % TUC_MOTION_HISTORY_CAPACITY;
+        if (history->samples[newest].timestamp == timestamp) {
+            history->samples[newest].location = location;
+            return;
+        }
+    }
+    
+    TUCMotionSample sample = { timestamp, location };
+    
+    if (history->count < TUC_MOTION_HISTORY_CAPACITY) {
+        history->samples[(history->start + history->count) % TUC_MOTION_HISTORY_CAPACITY] = sample;
+        history->count++;
+    } else {
+        history->samples[history->start] = sample;
+        history->start = (history->start + 1) % TUC_MOTION_HISTORY_CAPACITY;
+    }
+}
+
+
+
+#pragma mark - Least Squares
+
+/**
+ Power sums of the samples in the window, with time relative to the newest sample so the fit is well conditioned.
+ */
+typedef struct {
+    uint32_t n;
+    double t, tt, ttt, tttt;
+    double x, tx, ttx, xx;
+    double y, ty, tty, yy;
+} MotionSums;
+
+
+static void SumSamples(const TUCMotionHistory *history, double window, MotionSums *sums) {
+    memset(sums, 0, sizeof(MotionSums));
+    if (history->count == 0) {
+        return;
+    }
+    
+    TUCMotionSample newest = TUCMotionHistoryGetSample(history, history->count - 1);
+    
+    for (uint32_t i=history->count; i>0; i--) {
+        TUCMotionSample sample = TUCMotionHistoryGetSample(history, i - 1);
+        double t = sample.timestamp - newest.timestamp;
+        if (-t > window) {
+            break;
+        }
+        double x = sample.location.x - newest.location.x;
+        double y = sample.location.y - newest.location.y;
+        
+        sums->n++;
+        sums->t    += t;
+        sums->tt   += t * t;
+        sums->ttt  += t * t * t;
+        sums->tttt += t * t * t * t;
+        sums->x    += x;
+        sums->tx   += t * x;
+        sums->ttx  += t * t * x;
+        sums->xx   += x * x;
+        sums->y    += y;
+        sums->ty   += t * y;
+        sums->tty  += t * t * y;
+        sums->yy   += y * y;
+    }
+}
+
+
+bool TUCMotionHistoryVelocity(const TUCMotionHistory *history, double window, CGPoint *velocity) {
+    MotionSums s;
+    SumSamples(history, window, &s);
+    
+    double denominator = s.n * s.tt - s.t * s.t;
+    if (s.n < 2 || fabs(denominator) < 1e-12) {
+        *velocity = CGPointZero;
+        return false;
+    }
+    
+    velocity->x = (s.n * s.tx - s.t * s.x) / denominator;
+    velocity->y = (s.n * s.ty - s.t * s.y) / denominator;
+    return true;
+}
+
+
+static double Determinant3(double a, double b, double c,
+                           double d, double e, double f,
+                           double g, double h, double i) {
+    return a * (e * i - f * h) - b * (d * i - f * g) + c * (d * h - e * g);
+}
+
+
+bool TUCMotionHistoryAcceleration(const TUCMotionHistory *history, double window, CGPoint *acceleration) {
+    MotionSums s;
+    SumSamples(history, window, &s);
+    
+    // normal equations of x = a + b t + c t^2, solved for c with Cramer's rule
+    double n = s.n;
+    double determinant = Determinant3(n,    s.t,   s.tt,
+                                      s.t,  s.tt,  s.ttt,
+                                      s.tt, s.ttt, s.tttt);
+    
+    if (s.n < 3 || fabs(determinant) < 1e-24) {
+        *acceleration = CGPointZero;
+        return false;
+    }
+    
+    double cx = Determinant3(n,    s.t,   s.x,
+                             s.t,  s.tt,  s.tx,
+                             s.tt, s.ttt, s.ttx) / determinant;
+    double cy = Determinant3(n,    s.t,   s.y,
+                             s.t,  s.tt,  s.ty,
+                             s.tt, s.ttt, s.tty) / determinant;
+    
+    acceleration->x = 2 * cx;
+    acceleration->y = 2 * cy;
+    return true;
+}
+
+
+bool TUCMotionHistoryJitter(const TUCMotionHistory *history, double window, CGPoint *jitter) {
+    MotionSums s;
+    SumSamples(history, window, &s);
+    
+    double stt = s.n < 3 ? 0 : s.tt - s.t * s.t / s.n;
+    if (stt < 1e-12) {
+        *jitter = CGPointZero;
+        return false;
+    }
+    
+    // residual sum of squares of the line fit: Sxx - Stx^2 / Stt, the line uses two degrees of freedom
+    
+    double stx = s.tx - s.t * s.x / s.n;
+    double sty = s.ty - s.t * s.y / s.n;
+    double rssX = s.xx - s.x * s.x / s.n - stx * stx / stt;
+    double rssY = s.yy - s.y * s.y / s.n - sty * sty / stt;
+    
+    jitter->x = sqrt(fmax(rssX, 0) / (s.n - 2));
+    jitter->y = sqrt(fmax(rssY, 0) / (s.n - 2));
+    return true;
+}
@@ -0,0 +1,72 @@
+//
+//  TUCMotionHistory.h
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef TUCMotionHistory_h
+#define TUCMotionHistory_h
+
+#include <CoreGraphics/CoreGraphics.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ The latest locations of a contact with their timestamps, in a fixed-size ring that lives inside the touch: appending never allocates.
+ Velocity and acceleration are least squares fits over the samples of a recent time window, which is much less noisy than the
+ difference of the last two locations.
+ */
+
+#define TUC_MOTION_HISTORY_CAPACITY 16
+
+#define TUC_MOTION_VELOCITY_WINDOW      0.05    // s
+#define TUC_MOTION_ACCELERATION_WINDOW  0.1     // s
+
+
+typedef struct {
+    double  timestamp;      // s, system uptime
+    CGPoint location;
+} TUCMotionSample;
+
+
+typedef struct {
+    TUCMotionSample samples[TUC_MOTION_HISTORY_CAPACITY];
+    uint32_t start;         // index of the oldest sample
+    uint32_t count;
+} TUCMotionHistory;
+
+
+void TUCMotionHistoryReset(TUCMotionHistory *history);
+
+/**
+ Adds a sample, replacing the oldest one if the ring is full. A sample with the timestamp of the newest one replaces it.
+ */
+void TUCMotionHistoryAppend(TUCMotionHistory *history, double timestamp, CGPoint location);
+
+/**
+ `index` 0 is the oldest sample, `count - 1` the newest.
+ */
+static inline TUCMotionSample TUCMotionHistoryGetSample(const TUCMotionHistory *history, uint32_t index) {
+    return history->samples[(history->start + index) % TUC_MOTION_HISTORY_CAPACITY];
+}
+
+/**
+ Slope of a straight line through the samples of the last `window` seconds, in location units per second.
+ Returns false if there are fewer than two samples in the window.
+ */
+bool TUCMotionHistoryVelocity(const TUCMotionHistory *history, double window, CGPoint *velocity);
+
+/**
+ Second derivative of a parabola through the samples of the last `window` seconds, in location units per second squared.
+ Returns false if there are fewer than three samples in the window.
+ */
+bool TUCMotionHistoryAcceleration(const TUCMotionHistory *history, double window, CGPoint *acceleration);
+
+/**
+ Root mean square deviation of the samples of the last `window` seconds from the straight line of the velocity fit, per axis.
+ For a resting or evenly moving contact this is the noise of the digitizer. Returns false if there are fewer than three samples in the window.
+ */
+bool TUCMotionHistoryJitter(const TUCMotionHistory *history, double window, CGPoint *jitter);
+
+#endif /* TUCMotionHistory_h */
@@ -0,0 +1,45 @@
+//
+//  TUCPowerStatistics.h
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ CPU time and wakeups of the whole process, split into the time the input manager was active (touches on the screen,
+ momentum scrolling) and the time it was idle. Counted since the manager was created or the statistics were reset.
+ */
+@interface TUCPowerStatistics : NSObject
+
+@property (readonly) NSTimeInterval activeDuration;
+@property (readonly) NSTimeInterval activeCPUTime;
+@property (readonly) uint64_t activeWakeups;
+
+@property (readonly) NSTimeInterval idleDuration;
+@property (readonly) NSTimeInterval idleCPUTime;
+@property (readonly) uint64_t idleWakeups;
+
+/**
+ CPU time per second, 1 is one fully used core.
+ */
+@property (readonly) double activeCPULoad;
+@property (readonly) double idleCPULoad;
+
+@property (readonly) double activeWakeupsPerSecond;
+@property (readonly) double idleWakeupsPerSecond;
+
+
+- (instancetype)initWithActiveDuration:(NSTimeInterval)activeDuration
+                               cpuTime:(NSTimeInterval)activeCPUTime
+                               wakeups:(uint64_t)activeWakeups
+                          idleDuration:(NSTimeInterval)idleDuration
+                               cpuTime:(NSTimeInterval)idleCPUTime
+                               wakeups:(uint64_t)idleWakeups;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,53 @@
+//
+//  TUCPowerStatistics.m
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#import "TUCPowerStatistics.h"
+
+@implementation TUCPowerStatistics
+
+- (instancetype)initWithActiveDuration:(NSTimeInterval)activeDuration
+                               cpuTime:(NSTimeInterval)activeCPUTime
+                               wakeups:(uint64_t)activeWakeups
+                          idleDuration:(NSTimeInterval)idleDuration
+                               cpuTime:(NSTimeInterval)idleCPUTime
+                               wakeups:(uint64_t)idleWakeups {
+    if (self = [super init]) {
+        _activeDuration = activeDuration;
+        _activeCPUTime  = activeCPUTime;
+        _activeWakeups  = activeWakeups;
+        _idleDuration   = idleDuration;
+        _idleCPUTime    = idleCPUTime;
+        _idleWakeups    = idleWakeups;
+    }
+    return self;
+}
+
+
+- (double)activeCPULoad {
+    return self.activeDuration > 0 ? self.activeCPUTime / self.activeDuration : 0;
+}
+
+- (double)idleCPULoad {
+    return self.idleDuration > 0 ? self.idleCPUTime / self.idleDuration : 0;
+}
+
+- (double)activeWakeupsPerSecond {
+    return self.activeDuration > 0 ? self.activeWakeups / self.activeDuration : 0;
+}
+
+- (double)idleWakeupsPerSecond {
+    return self.idleDuration > 0 ? self.idleWakeups / self.idleDuration : 0;
+}
+
+
+- (NSString *)debugDescription {
+    return [NSString stringWithFormat:@"active %.1f s: %.2f %% CPU, %.1f wakeups/s; idle %.1f s: %.2f %% CPU, %.1f wakeups/s",
+            self.activeDuration, self.activeCPULoad * 100, self.activeWakeupsPerSecond,
+            self.idleDuration, self.idleCPULoad * 100, self.idleWakeupsPerSecond];
+}
+
+@end
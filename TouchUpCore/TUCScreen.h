@@ -9,6 +9,36 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ The part of a screen that is needed to map digitizer points to it, as plain value. Threads other than the main thread
+ work with a copy of it instead of the `TUCScreen`, which the main thread may change at any time.
+ */
+typedef struct {
+    CGFloat rotation;       // 0, 90, 180 or 270
+    CGRect  frame;
+} TUCScreenGeometry;
+
+/**
+ The relative digitizer points are always in the direction the digitizer is built in. If the display is rotated,
+ they are turned with it.
+ */
+static inline CGPoint TUCScreenGeometryConvertDigitizerPoint(const TUCScreenGeometry *geometry, CGPoint devicePoint) {
+    if (geometry->rotation == 180) {
+        return CGPointMake(1 - devicePoint.x, 1 - devicePoint.y);
+    } else if (geometry->rotation == 90) {
+        return CGPointMake(1 - devicePoint.y, devicePoint.x);
+    } else if (geometry->rotation == 270) {
+        return CGPointMake(devicePoint.y, 1 - devicePoint.x);
+    }
+    return devicePoint;
+}
+
+static inline CGPoint TUCScreenGeometryConvertRelativeToAbsolute(const TUCScreenGeometry *geometry, CGPoint relativePoint) {
+    return CGPointMake(relativePoint.x * geometry->frame.size.width + geometry->frame.origin.x,
+                       relativePoint.y * geometry->frame.size.height - geometry->frame.origin.y);
+}
+
+
 /**
  The `TUCScreen` augments `NSScreen` with access to additional screen layout properties and information on the conversion of digitizer coordinate system to pixels.
  */
@@ -21,6 +51,7 @@ NS_ASSUME_NONNULL_BEGIN
 @property CGRect frame;
 
 - (CGFloat)pixelsPerMM;
+- (TUCScreenGeometry)geometry;
 - (CGPoint)convertPointRelativeToAbsolute:(CGPoint)relativePoint;
 
 - (nullable NSScreen *)systemScreen;
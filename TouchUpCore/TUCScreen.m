@@ -60,15 +60,13 @@
     return self.frame.size.width / self.physicalSize.width;
 }
 
+- (TUCScreenGeometry)geometry {
+    return (TUCScreenGeometry){ self.rotation, self.frame };
+}
+
 - (CGPoint)convertPointRelativeToAbsolute:(CGPoint)relativePoint {
-    CGPoint screenOrigin = self.frame.origin;
-    CGSize screenSize = self.frame.size;
-    
-    
-    CGPoint absLoc = CGPointMake(relativePoint.x * screenSize.width + screenOrigin.x,
-                                 relativePoint.y * screenSize.height - screenOrigin.y);
-    
-    return absLoc;
+    TUCScreenGeometry geometry = [self geometry];
+    return TUCScreenGeometryConvertRelativeToAbsolute(&geometry, relativePoint);
 }
 
 
@@ -6,6 +6,7 @@
 //
 
 #import <AppKit/AppKit.h>
+#import "TUCMotionHistory.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -19,7 +20,11 @@ typedef NS_OPTIONS(NSUInteger, TUCCursorGesture) {
     TUCCursorGestureHoldAndDrag     = 1 << 5,
     TUCCursorGestureTapSecondFinger = 1 << 6,
     TUCCursorGestureTwoFingerDrag   = 1 << 7,
-    TUCCursorGesturePinch           = 1 << 8  // internal: pinch cannot be remapped
+    TUCCursorGesturePinch           = 1 << 8, // internal: pinch cannot be remapped
+    TUCCursorGestureTwoFingerRotate = 1 << 9,
+    TUCCursorGestureThreeFingerSwipe = 1 << 10,
+    TUCCursorGestureFourFingerSwipe = 1 << 11,
+    TUCCursorGestureTwoFingerScroll = 1 << 12  // two fingers moving together, unlike a two finger drag it is never remapped to a drag
 };
 
 
@@ -32,12 +37,15 @@ typedef NS_ENUM(NSUInteger, TUCCursorAction) {
     TUCCursorActionClick,
     TUCCursorActionSecondaryClick,
     TUCCursorActionScroll,
-    TUCCursorActionMagnify
+    TUCCursorActionMagnify,
+    TUCCursorActionRotate,
+    TUCCursorActionNavigateHistory, // swipe: back and forward like the trackpad
+    TUCCursorActionSwitchSpace      // swipe: spaces left and right, Mission Control up, App Exposé down
 };
 
 
 
-@interface TUCTouch : NSObject
+@interface TUCTouch : NSObject <NSCopying>
 
 @property (strong) NSUUID *uuid;
 @property NSInteger contactID;
@@ -54,11 +62,21 @@ typedef NS_ENUM(NSUInteger, TUCCursorAction) {
 @property (nonatomic) CGPoint location;
 @property CGPoint previousLocation;
 
+/**
+ The latest locations with their timestamps (system uptime), oldest first. Returned as a copy of the fixed-size ring inside the touch.
+ */
+@property (readonly) TUCMotionHistory motionHistory;
+
 @property NSInteger lastUpdated; // the page ID during last update
 
 
 - (instancetype)initWithContactID:(NSInteger)contactID ;
 
+/**
+ Sets the location and records it in the motion history.
+ */
+- (void)setLocation:(CGPoint)location timestamp:(NSTimeInterval)timestamp;
+
 
 
 - (BOOL)isActive;
@@ -68,6 +86,19 @@ typedef NS_ENUM(NSUInteger, TUCCursorAction) {
 - (CGPoint)trajectory;
 - (CGPoint)trajectorySign;
 
+/**
+ Least squares estimates from the motion history, in relative screen units per second (squared).
+ Zero if there are too few samples in the interval.
+ */
+- (CGPoint)velocity;
+- (CGPoint)velocityOverInterval:(NSTimeInterval)interval;
+- (CGPoint)accelerationOverInterval:(NSTimeInterval)interval;
+
+/**
+ Deviation of the locations from the fitted line, see `TUCMotionHistoryJitter`. Returns NO if there are fewer than three samples in the interval.
+ */
+- (BOOL)getJitter:(CGPoint *)jitter overInterval:(NSTimeInterval)interval;
+
 @end
 
 NS_ASSUME_NONNULL_END
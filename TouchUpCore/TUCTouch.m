@@ -7,7 +7,9 @@
 
 #import "TUCTouch.h"
 
-@implementation TUCTouch
+@implementation TUCTouch {
+    TUCMotionHistory _motionHistory;
+}
 
 - (instancetype)initWithContactID:(NSInteger)contactID {
     if (self = [super init]) {
@@ -33,6 +35,8 @@
         
         _location = CGPointZero;
         _previousLocation = CGPointZero;
+        
+        TUCMotionHistoryReset(&_motionHistory);
     }
     return self;
 }
@@ -64,6 +68,17 @@
 }
 
 
+- (void)setLocation:(CGPoint)location timestamp:(NSTimeInterval)timestamp {
+    [self setLocation:location];
+    TUCMotionHistoryAppend(&_motionHistory, timestamp, location);
+}
+
+
+- (TUCMotionHistory)motionHistory {
+    return _motionHistory;
+}
+
+
 
 #pragma mark - Gesture Detection
 
@@ -82,7 +97,45 @@
 }
 
 
+- (CGPoint)velocity {
+    return [self velocityOverInterval:TUC_MOTION_VELOCITY_WINDOW];
+}
+
+- (CGPoint)velocityOverInterval:(NSTimeInterval)interval {
+    CGPoint velocity;
+    TUCMotionHistoryVelocity(&_motionHistory, interval, &velocity);
+    return velocity;
+}
+
+- (CGPoint)accelerationOverInterval:(NSTimeInterval)interval {
+    CGPoint acceleration;
+    TUCMotionHistoryAcceleration(&_motionHistory, interval, &acceleration);
+    return acceleration;
+}
+
+- (BOOL)getJitter:(CGPoint *)jitter overInterval:(NSTimeInterval)interval {
+    return TUCMotionHistoryJitter(&_motionHistory, interval, jitter);
+}
+
+
 #pragma mark - Utility
+
+- (id)copyWithZone:(NSZone *)zone {
+    TUCTouch *copy = [[TUCTouch allocWithZone:zone] initWithContactID:_contactID];
+    copy->_uuid = _uuid;
+    copy->_isOnSurface = _isOnSurface;
+    copy->_confidenceFlag = _confidenceFlag;
+    copy->_size = _size;
+    copy->_azimuth = _azimuth;
+    copy->_phase = _phase;
+    copy->_previousPhase = _previousPhase;
+    copy->_location = _location;
+    copy->_previousLocation = _previousLocation;
+    copy->_lastUpdated = _lastUpdated;
+    copy->_motionHistory = _motionHistory;
+    return copy;
+}
+
 - (BOOL)isActive {
     return _phase != NSTouchPhaseEnded && _phase != NSTouchPhaseCancelled;
 }
@@ -8,6 +8,7 @@
 #import <AppKit/AppKit.h>
 #import <CoreGraphics/CoreGraphics.h>
 #import "TUCTouch.h"
+#import "TUCTouchFrame.h"
 #import "TUCScreen.h"
 
 NS_ASSUME_NONNULL_BEGIN
@@ -17,10 +18,17 @@ NS_ASSUME_NONNULL_BEGIN
 #pragma mark - Touch Data
 /**
  
- This method is called every time after the `touchSet` was updated
+ This method is called once per published frame, i.e. after the `touchSet` was updated by a complete report.
  */
 - (void)touchesDidChange;
 
+@optional
+/**
+ Called right before `touchesDidChange` with the frame that was published. Use the contact IDs of the frame to update incrementally.
+ */
+- (void)touchesDidChangeInFrame:(TUCTouchFrame *)frame;
+@required
+
 
 
 #pragma mark - Lifecycle
@@ -0,0 +1,54 @@
+//
+//  TUCTouchFrame.h
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#import <Foundation/Foundation.h>
+#import "TUCTouch.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ An immutable snapshot of all touches after one complete report of the touchscreen.
+ Frames are never changed after they were published, so they can be read from any thread without locking.
+ */
+@interface TUCTouchFrame : NSObject
+
+@property (readonly) NSInteger frameID;
+
+/**
+ System uptime when the frame was published.
+ */
+@property (readonly) NSTimeInterval timestamp;
+
+/**
+ Copies of the touches in the touch set, sorted by contact ID. Ended touches stay in the frame for a short time, like in the touch set.
+ */
+@property (readonly, copy) NSArray<TUCTouch *> *touches;
+
+
+#pragma mark Changes since the previous frame
+
+@property (readonly, copy) NSIndexSet *beganContactIDs;
+@property (readonly, copy) NSIndexSet *movedContactIDs;
+@property (readonly, copy) NSIndexSet *endedContactIDs;
+@property (readonly, copy) NSIndexSet *cancelledContactIDs;
+
+/**
+ NO if no contact began, moved, ended or was cancelled, e.g. if the frame was only published to drop touches that ended earlier.
+ */
+- (BOOL)hasChanges;
+
+
+- (instancetype)initWithFrameID:(NSInteger)frameID
+                        touches:(NSArray<TUCTouch *> *)touches
+                          began:(NSIndexSet *)began
+                          moved:(NSIndexSet *)moved
+                          ended:(NSIndexSet *)ended
+                      cancelled:(NSIndexSet *)cancelled;
+
+@end
+
+NS_ASSUME_NONNULL_END
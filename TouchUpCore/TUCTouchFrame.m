@@ -0,0 +1,49 @@
+//
+//  TUCTouchFrame.m
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#import "TUCTouchFrame.h"
+
+@implementation TUCTouchFrame
+
+- (instancetype)initWithFrameID:(NSInteger)frameID
+                        touches:(NSArray<TUCTouch *> *)touches
+                          began:(NSIndexSet *)began
+                          moved:(NSIndexSet *)moved
+                          ended:(NSIndexSet *)ended
+                      cancelled:(NSIndexSet *)cancelled {
+    if (self = [super init]) {
+        _frameID = frameID;
+        _timestamp = [[NSProcessInfo processInfo] systemUptime];
+        
+        NSMutableArray<TUCTouch *> *copies = [NSMutableArray arrayWithCapacity:touches.count];
+        for (TUCTouch *touch in touches) {
+            [copies addObject:[touch copy]];
+        }
+        [copies sortUsingSelector:@selector(compareWithAnotherTouch:)];
+        _touches = [copies copy];
+        
+        _beganContactIDs     = [began copy];
+        _movedContactIDs     = [moved copy];
+        _endedContactIDs     = [ended copy];
+        _cancelledContactIDs = [cancelled copy];
+    }
+    return self;
+}
+
+
+- (BOOL)hasChanges {
+    return _beganContactIDs.count > 0 || _movedContactIDs.count > 0 || _endedContactIDs.count > 0 || _cancelledContactIDs.count > 0;
+}
+
+
+- (NSString *)debugDescription {
+    return [NSString stringWithFormat:@"Frame %ld: %ld touches, began %@ moved %@ ended %@ cancelled %@",
+            self.frameID, self.touches.count,
+            self.beganContactIDs, self.movedContactIDs, self.endedContactIDs, self.cancelledContactIDs];
+}
+
+@end
@@ -10,6 +10,9 @@
 #ifndef TUCTouchInputManager_C_h
 #define TUCTouchInputManager_C_h
 
+// mach absolute time of the report whose touches are updated next
+void TouchInputManagerSetReportTimestamp(void *self, uint64_t timestamp);
+
 void TouchInputManagerUpdateTouchPosition(void *self, CFIndex contactID, CGFloat x, CGFloat y, Boolean onSurface, Boolean isValid);
 
 void TouchInputManagerUpdateTouchSize(void *self, CFIndex contactID, CGFloat width, CGFloat height, CGFloat azimuth);
@@ -17,8 +20,16 @@ void TouchInputManagerUpdateTouchSize(void *self, CFIndex contactID, CGFloat wid
 // called after a full report (no partials in hybrid modes) was handled
 void TouchInputManagerDidProcessReport(void *self);
 
+// the same in two steps, for the gestures and publish stages of the frame pipeline
+void TouchInputManagerRecognizeGestures(void *self);
+void TouchInputManagerPublishFrame(void *self);
+
 void TouchInputManagerDidConnectTouchscreen(void *self);
 
+// called on the pen thread for every pen report, the location is relative in digitizer orientation and tilt is -1...1
+void TouchInputManagerUpdatePen(void *self, CGFloat x, CGFloat y, CGFloat pressure, CGFloat tiltX, CGFloat tiltY,
+                                Boolean inRange, Boolean tipSwitch, Boolean barrelSwitch, Boolean eraser);
+
 void TouchInputManagerDidDisconnectTouchscreen(void *self);
 
 #endif /* TUCTouchInputManager_C_h */
@@ -9,6 +9,12 @@
 #import "TUCTouchInputManager-C.h"
 #import "TUCTouchDelegate.h"
 #import "TUCTouch.h"
+#import "TUCTouchFrame.h"
+#import "TUCPowerStatistics.h"
+#import "TUCIngestionStatistics.h"
+#import "TUCFrameStageStatistics.h"
+#import "HIDFramePipeline.h"
+#import "TUCTrace.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -18,22 +24,38 @@ NS_ASSUME_NONNULL_BEGIN
 
 @property (weak, nonatomic) id<TUCTouchDelegate> delegate;
 
+/**
+ The live touch set. It is changed on the main thread while a report is processed, so read `currentFrame` from anywhere else.
+ */
 @property (strong, atomic) NSMutableSet<TUCTouch *> *touchSet;
 
+/**
+ The snapshot published after the latest complete report. Safe to read from any thread.
+ */
+@property (strong, atomic, readonly) TUCTouchFrame *currentFrame;
+
 /**
  Allows to deactiate that the framework processes touches to post them as mouse events.
- The default value is YES.
+ Also read by the pen thread. The default value is YES.
  */
 @property BOOL postMouseEvents;
 
 
+/**
+ Sends the mouse down as soon as the cursor touch stayed still for the hold duration, instead of sending mouse down and up together
+ when the finger lifts or moves. Lifting the finger releases it as a click, moving turns it into a drag. A second finger releases it
+ where it was pressed. Only used if taps are mapped to clicks and holds to drags. The default value is NO.
+ */
+@property BOOL speculativeTouchDown;
+
+
 /**
  The maximal distance in mm that two taps may be apart from each other to count as double click
  */
 @property CGFloat doubleClickTolerance;
 
 /**
- How long the user has to hold before a drag gesture turns into holdAndDrag.
+ How long the user has to hold before a drag gesture turns into holdAndDrag, measured with the report timestamps.
  */
 @property NSTimeInterval holdDuration;
 
@@ -53,6 +75,74 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (void)stop;
 
+/**
+ Call on the main thread when the delegate returns a different touchscreen, or its rotation or frame changed.
+ The pen thread works with a copy of the touchscreen that is taken here.
+ */
+- (void)touchscreenDidChange;
+
+
+/**
+ YES while there are no touches and no momentum scrolling. Nothing is scheduled while idle, the next report ends it.
+ */
+@property (readonly, atomic) BOOL isIdle;
+
+/**
+ CPU time and wakeups of the process in the active and the idle state, to track power regressions.
+ Every state change is also recorded in the trace (PowerState event).
+ */
+- (TUCPowerStatistics *)powerStatistics;
+
+- (void)resetPowerStatistics;
+
+
+/**
+ Report rate (Hz) and noise floor (mm) of the touchscreen, measured from its reports since it connected. 0 until measured.
+ A touch is stationary below `stationarySpeed` (mm/s), which is raised from 10 mm/s on noisy screens so resting fingers do not seem to move.
+ Read on the main thread.
+ */
+@property (readonly) double measuredReportRate;
+@property (readonly) CGFloat measuredNoiseFloor;
+@property (readonly) CGFloat stationarySpeed;
+
+
+/**
+ How many touch reports were dispatched, merged while catching up after a stall, or lost before they arrived.
+ Read on the main thread.
+ */
+- (TUCIngestionStatistics *)ingestionStatistics;
+
+- (void)resetIngestionStatistics;
+
+
+/**
+ Decoded touch reports pass a pipeline of C stages that work in place on one preallocated `HIDContactFrame`: decode, scan time,
+ ingest, and the steps of this manager: track, gestures and publish. Custom stages, like a coordinate filter in front of track or a
+ palm check in front of gestures, are inserted in front of one of them, or at the end if `nextStage` is nil, and cost nothing when
+ they are removed. A stage that returns false drops the frame. The stages stay installed when the touchscreen changes.
+ Screens decoded via their IOHIDElements do not use the pipeline. Can be called from any thread, also from within a stage;
+ the change applies from the next frame on.
+ */
+- (BOOL)insertFrameStageNamed:(NSString *)name function:(HIDFrameStageFunction)function context:(nullable void *)context
+                  beforeStage:(nullable NSString *)nextStage;
+- (BOOL)removeFrameStageNamed:(NSString *)name;
+
+/**
+ One entry per stage, in pipeline order. The stages are only timed while a trace of level info or higher runs.
+ */
+- (NSArray<TUCFrameStageStatistics *> *)frameStageStatistics;
+
+- (void)resetFrameStageStatistics;
+
+
+/**
+ Records the input path into a binary trace file. Use the `tuc-trace-decode` tool to turn it into a readable timeline.
+ Returns NO if the file cannot be created or a trace is already running.
+ */
+- (BOOL)startTracingToFile:(NSString *)path level:(TUCTraceLevel)level;
+
+- (void)stopTracing;
+
 
 
 - (CGPoint)convertScreenPointRelativeToAbsolute:(CGPoint)relativePoint;
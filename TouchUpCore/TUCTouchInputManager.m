@@ -8,27 +8,96 @@
 #import "TUCTouchInputManager.h"
 
 #import "HIDInterpreter.h"
+#import "TUCContactStatistics.h"
+#import "TUCDigitizerProfile.h"
 #import "TUCCursorUtilities.h"
 
+#import <libproc.h>
+#import <mach/mach_time.h>
+#import <os/lock.h>
+#import <stdatomic.h>
+
+#define TUC_TOUCH_RECLAIM_DELAY 0.5
+
+
+/**
+ Resource usage of the process at one point in time, or summed up over one power state.
+ */
+typedef struct {
+    uint64_t durationNs;    // for a point in time: system uptime
+    uint64_t cpuNs;
+    uint64_t wakeups;
+} TUCUsageSample;
+
+static TUCUsageSample SampleUsage(void) {
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    
+    TUCUsageSample sample = { clock_gettime_nsec_np(CLOCK_UPTIME_RAW), 0, 0 };
+    
+    struct rusage_info_v4 info;
+    if (proc_pid_rusage(getpid(), RUSAGE_INFO_V4, (rusage_info_t *)&info) == 0) {
+        // CPU times are in mach absolute time units
+        sample.cpuNs   = (info.ri_user_time + info.ri_system_time) * timebase.numer / timebase.denom;
+        sample.wakeups = info.ri_pkg_idle_wkups + info.ri_interrupt_wkups;
+    }
+    return sample;
+}
+
+
+
 @interface TUCTouchInputManager ()
 
 @property NSInteger currentFrameID;
+@property NSTimeInterval reportTimestamp; // s, system uptime; 0 if the next report has none
 
 @property (weak, nullable) TUCTouch *cursorTouch;
 @property (weak, nullable) TUCTouch *gestureAdditionalTouch;
 
 @property BOOL cursorTouchQualifiedForTap; // if the cursor entered moving state once it can no longer be interpreted as tap
 @property BOOL cursorTouchDidHold; //
-@property (strong) NSDate *cursorTouchStationarySinceDate;
-
-@property CGFloat pinchDistance;
+@property BOOL cursorTouchDidClickOnTouchDown; // the touch down brought a window to front, pressing again would be a double click
+@property BOOL cursorTouchWasPressed; // a speculative mouse down was sent for this touch
+@property NSTimeInterval cursorTouchStationarySince; // report timestamp, 0 while the cursor touch moves
 
 @property TUCCursorGesture identifiedMultitouchGesture;
+@property TUCMultitouchState multitouchState;
+@property TUCSimilarityTransform multitouchDelta; // of the contacts since the previous frame, limited to the recognized kind
+@property BOOL multitouchDidSwipe; // a swipe fires once, the remaining fingers are ignored until all lifted
+
+@property TUCDigitizerProfile digitizerProfile;
+
+@property (strong, atomic, readwrite) TUCTouchFrame *currentFrame;
+
+// contact IDs that changed since the last published frame
+@property (strong) NSMutableIndexSet *beganContactIDs;
+@property (strong) NSMutableIndexSet *movedContactIDs;
+@property (strong) NSMutableIndexSet *endedContactIDs;
+@property (strong) NSMutableIndexSet *cancelledContactIDs;
+
+// touches that ended, by uuid: system uptime when they are removed from the touch set
+@property (strong) NSMutableDictionary<NSUUID *, NSNumber *> *reclaimDeadlines;
+@property BOOL isReclaimScheduled;
+
+
+@property (readwrite, atomic) BOOL isIdle;
+@property TUCUsageSample powerStateStart;
+@property TUCUsageSample activeUsage;
+@property TUCUsageSample idleUsage;
 
 @end
 
 
-@implementation TUCTouchInputManager
+@implementation TUCTouchInputManager {
+    _Atomic BOOL _postMouseEvents; // read by the pen thread
+    
+    // the touchscreen as seen by the pen thread: a copy, written on the main thread whenever the touchscreen may have changed
+    os_unfair_lock _penScreenLock;
+    TUCScreenGeometry _penScreen;
+    BOOL _hasPenScreen;
+}
 
 #pragma mark   Start & Stop
 
@@ -36,6 +105,9 @@
     
     __weak id weakSelf = self;
     
+    // the pen thread never waits for the main thread, so its screen has to be there before the first report
+    [self touchscreenDidChange];
+    
     // needs to run on main anyway
 //    [NSThread detachNewThreadWithBlock:^{
 //        [NSThread setThreadPriority:1];
@@ -49,8 +121,42 @@
 }
 
 
+- (BOOL)postMouseEvents {
+    return atomic_load_explicit(&_postMouseEvents, memory_order_relaxed);
+}
+
+- (void)setPostMouseEvents:(BOOL)postMouseEvents {
+    atomic_store_explicit(&_postMouseEvents, postMouseEvents, memory_order_relaxed);
+}
+
+
+- (BOOL)startTracingToFile:(NSString *)path level:(TUCTraceLevel)level {
+    return TUCTraceStart([path fileSystemRepresentation], level);
+}
+
+- (void)stopTracing {
+    TUCTraceStop();
+}
+
+
 - (void)didConnectTouchscreen {
+    TUCDigitizerProfile profile;
+    TUCDigitizerProfileReset(&profile);
+    self.digitizerProfile = profile;
+    
     [self.delegate touchscreenDidConnect];
+    [self touchscreenDidChange];
+}
+
+
+- (void)touchscreenDidChange {
+    TUCScreen *screen = [self touchscreen];
+    TUCScreenGeometry geometry = screen ? [screen geometry] : (TUCScreenGeometry){ 0 };
+    
+    os_unfair_lock_lock(&_penScreenLock);
+    _penScreen = geometry;
+    _hasPenScreen = screen != nil;
+    os_unfair_lock_unlock(&_penScreenLock);
 }
 
 - (void)didDisconnectTouchscreen {
@@ -62,41 +168,115 @@
 #pragma mark - Reacting to HID Events
 
 - (void)didProcessReport {
+    [self recognizeGestures];
+    [self finishFrame];
+}
+
+
+/**
+ The gestures stage of the frame pipeline: the touches of the report are updated, now the stale ones end and the rest is turned
+ into cursor input.
+ */
+- (void)recognizeGestures {
+    [self leaveIdle];
+    
+    [self reclaimEndedTouches];
+    
     // go through all touches: if the frame is not the latest one, the touch might be old and should be removed.
     
     for (TUCTouch *touch in self.touchSet) {
         
         if (touch.lastUpdated + self.errorResistance < self.currentFrameID) {
+            if (touch.isActive) {
+                [self.cancelledContactIDs addIndex:touch.contactID];
+            }
             [touch setPhase:NSTouchPhaseCancelled];
             [self removeTouch:touch now:NO];
         }
     }
     
+    [self resolveSpeculativePress];
+    
     if ([[self activeTouches] count] == 0) {
         [self stopCurrentGesture];
+        
+        TUCMultitouchState state;
+        TUCMultitouchReset(&state);
+        self.multitouchState = state;
     }
     
     ++self.currentFrameID;
     
+    [self updateDigitizerProfile];
+    
     [self processTouchesForCursorInput];
+}
+
+
+/**
+ The publish stage of the frame pipeline. A frame that ended before it folds its changes into the next published one.
+ */
+- (void)finishFrame {
+    [self publishFrame];
     
+    [self enterIdleIfPossible];
+}
+
+
+/**
+ Takes an immutable snapshot of the touch set and hands it to the delegate. This happens once per report, not once per touch.
+ */
+- (void)publishFrame {
+    TUCTouchFrame *frame = [[TUCTouchFrame alloc] initWithFrameID:self.currentFrameID
+                                                          touches:[self.touchSet allObjects]
+                                                            began:self.beganContactIDs
+                                                            moved:self.movedContactIDs
+                                                            ended:self.endedContactIDs
+                                                        cancelled:self.cancelledContactIDs];
+    [self.beganContactIDs removeAllIndexes];
+    [self.movedContactIDs removeAllIndexes];
+    [self.endedContactIDs removeAllIndexes];
+    [self.cancelledContactIDs removeAllIndexes];
+    
+    self.currentFrame = frame;
+    
+    id<TUCTouchDelegate> delegate = self.delegate;
+    if ([delegate respondsToSelector:@selector(touchesDidChangeInFrame:)]) {
+        [delegate touchesDidChangeInFrame:frame];
+    }
+    [delegate touchesDidChange];
 }
 
 
 - (void)stopCurrentGesture {
     [[TUCCursorUtilities sharedInstance] stopDraggingCursor];
     [[TUCCursorUtilities sharedInstance] stopMagnifying];
+    [[TUCCursorUtilities sharedInstance] stopRotating];
 
     self.identifiedMultitouchGesture = _TUCCursorGestureNone;
 }
 
 
 
+/**
+ The timestamp of the report that is processed, in the time base of the motion history. Now, if the report had none.
+ */
+- (NSTimeInterval)timestampOfCurrentReport {
+    if (self.reportTimestamp > 0) {
+        return self.reportTimestamp;
+    }
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW) / 1e9;
+}
+
+
+
 /**
  Most important event handling callback: it posts the events to the system where the touches need to go
  */
 - (void)updateTouch:(NSInteger)contactID withLocation:(CGPoint)digitizerPoint onSurface:(BOOL)isOnSurface tooLargeForFinger:(BOOL)confidenceFlag {
     
+    [self leaveIdle];
+    
     // assume that this is an erroneous message!!!
     if (self.ignoreOriginTouches && CGPointEqualToPoint(digitizerPoint, CGPointZero)) {
         return;
@@ -107,49 +287,69 @@
     BOOL isNewTouch = NO;
     TUCTouch *touch = [self obtainTouchWithID:contactID isNew:&isNewTouch];
     
+    if (isNewTouch) {
+        [self.beganContactIDs addIndex:contactID];
+    }
+    
     if (isNewTouch && (self.cursorTouch == nil || !self.cursorTouch.isActive)) {
         self.cursorTouch = touch;
         self.cursorTouchQualifiedForTap = YES;
         self.cursorTouchDidHold = NO;
-        self.cursorTouchStationarySinceDate = nil;
+        self.cursorTouchDidClickOnTouchDown = NO;
+        self.cursorTouchWasPressed = NO;
+        self.cursorTouchStationarySince = 0;
+        self.multitouchDidSwipe = NO;
     }
     
-    [touch setLocation: point];
+    [touch setLocation:point timestamp:[self timestampOfCurrentReport]];
     [touch setIsOnSurface:isOnSurface];
     [touch setConfidenceFlag:confidenceFlag];
     [touch setLastUpdated:self.currentFrameID];
     
     if (!isOnSurface) {
         [touch setPhase: NSTouchPhaseEnded];
+        [self.endedContactIDs addIndex:contactID];
         [self removeTouch:touch now:NO];
-        [self.delegate touchesDidChange];
         return;
         
     }
     
     if(touch.previousPhase != NSTouchPhaseEnded && !isNewTouch) {
         // update to an existing touch... check if stationary or not
-        CGFloat digitizerRelDistance = sqrt(pow(touch.location.x - touch.previousLocation.x, 2) + pow(touch.location.y - touch.previousLocation.y, 2));
-        CGFloat screenSize = [self touchscreen].physicalSize.width;
-        BOOL isStationary = (digitizerRelDistance * screenSize) < 0.1;
+        // the speed over the last reports, a single step is too noisy
+        TUCDigitizerProfile profile = self.digitizerProfile;
+        CGSize screenSize = [self touchscreen].physicalSize;
+        CGPoint velocity = [touch velocityOverInterval:TUCDigitizerProfileVelocityWindow(&profile)];
+        CGFloat speed = hypot(velocity.x * screenSize.width, velocity.y * screenSize.height);
+        BOOL isStationary = speed < TUCDigitizerProfileStationarySpeed(&profile);
 //        BOOL isStationary = CGPointEqualToPoint(touch.location, touch.previousLocation);
         
+        if (isStationary) {
+            // a resting finger shows how noisy the screen is
+            CGPoint jitter;
+            if ([touch getJitter:&jitter overInterval:2 * TUCDigitizerProfileVelocityWindow(&profile)]) {
+                TUCDigitizerProfileAddJitter(&profile, hypot(jitter.x * screenSize.width, jitter.y * screenSize.height));
+                self.digitizerProfile = profile;
+            }
+        }
+        
         if (touch.uuid == self.cursorTouch.uuid) {
             if (!isStationary) {
                 self.cursorTouchQualifiedForTap = NO;
-                self.cursorTouchStationarySinceDate = nil;
+                self.cursorTouchStationarySince = 0;
                 
             } else if (touch.phase !=  NSTouchPhaseStationary) {
-                self.cursorTouchStationarySinceDate = [NSDate date];
+                self.cursorTouchStationarySince = [self timestampOfCurrentReport];
             }
         }
         
         [touch setPhase:isStationary ? NSTouchPhaseStationary : NSTouchPhaseMoved];
+        
+        if (!isStationary) {
+            [self.movedContactIDs addIndex:contactID];
+        }
     }
     
-    
-    [self.delegate touchesDidChange];
-    
     return;
 }
 
@@ -190,17 +390,21 @@
     
     else if (phase == NSTouchPhaseStationary) {
         NSTimeInterval holdDuration = 0;
-        if (self.cursorTouchStationarySinceDate != nil) {
-            holdDuration = [[NSDate date] timeIntervalSinceDate:self.cursorTouchStationarySinceDate];
+        if (self.cursorTouchStationarySince > 0) {
+            holdDuration = [self timestampOfCurrentReport] - self.cursorTouchStationarySince;
         }
         if (self.cursorTouchQualifiedForTap && holdDuration > self.holdDuration) {
             // the user left the finger on the screen for the min duration required to produce a hold
             self.cursorTouchDidHold = YES;
         }
         
-        [self checkForSecondaryClick];
-        
-        return;
+        // the cursor finger can rest while the others pinch or turn around it
+        if ([touches count] < 2 || self.multitouchDidSwipe) {
+            if (![self checkForSecondaryClick]) {
+                [self beginSpeculativePressIfPossible];
+            }
+            return;
+        }
     }
     
     
@@ -215,7 +419,8 @@
         
         [self stopCurrentGesture];
         
-        if (self.cursorTouchQualifiedForTap) {
+        if (self.cursorTouchQualifiedForTap && !self.cursorTouchWasPressed) {
+            // with a speculative press, the click was already completed by resolveSpeculativePress
             [self performMouseEventForGesture:TUCCursorGestureTap];
         } else {
             if (self.identifiedMultitouchGesture != _TUCCursorGestureNone) {
@@ -232,56 +437,50 @@
         return;
     }
     
+    if (self.multitouchDidSwipe) {
+        return;
+    }
+    
     if ([self checkForSecondaryClick]) {
         return;
     }
     
-    if ([touches count] == 2 && [touches containsObject: cursorTouch]) {
-        // check if we need to initiate two finger drag, pinch, ...
-        if (self.identifiedMultitouchGesture == _TUCCursorGestureNone ) {
-
-            TUCTouch *otherTouch = touches[1];
-            if (otherTouch.uuid == cursorTouch.uuid) {
-                otherTouch = touches[0];
-            }
-            
-            self.gestureAdditionalTouch = otherTouch;
+    if ([touches count] >= 2 && [touches containsObject: cursorTouch]) {
+        // check if we need to initiate two finger drag, pinch, rotate, swipe...
+        TUCMultitouchKind kind = [self updateMultitouchStateWithTouches:touches];
+        
+        // a finger was added or lifted, the contacts start over as a new gesture
+        if (kind == TUCMultitouchKindNone && self.identifiedMultitouchGesture != _TUCCursorGestureNone) {
+            [self stopCurrentGesture];
+        }
+        
+        if (self.identifiedMultitouchGesture == _TUCCursorGestureNone) {
+            self.identifiedMultitouchGesture = [self gestureForMultitouchKind:kind numberOfTouches:touches.count];
             
-            if (self.gestureAdditionalTouch.isActive) {
-                CGPoint trajectoryA = [cursorTouch trajectorySign];
-                CGPoint trajectoryB = [otherTouch trajectorySign];
-                
-                
-                if (   !CGPointEqualToPoint(trajectoryA, CGPointZero)
-                    && !CGPointEqualToPoint(trajectoryB, CGPointZero)) {
-                    
-                    if (!CGPointEqualToPoint(trajectoryA, trajectoryB)) {
-                        self.identifiedMultitouchGesture = TUCCursorGesturePinch;
-                    }
-//                    else {
-//                        self.identifiedMultitouchGesture = TUCCursorGestureTwoFingerDrag;
-//                    }
-                }
-                
-            } else {
-                // secondary click
-                [self removeTouch:self.gestureAdditionalTouch now:YES];
-                self.gestureAdditionalTouch = nil;
-                [self performMouseEventForGesture:TUCCursorGestureTapSecondFinger];
+            if (self.identifiedMultitouchGesture == TUCCursorGestureThreeFingerSwipe
+                || self.identifiedMultitouchGesture == TUCCursorGestureFourFingerSwipe) {
+                [[TUCCursorUtilities sharedInstance] stopDraggingCursor];
+                [self performMouseEventForGesture:self.identifiedMultitouchGesture];
+                self.multitouchDidSwipe = YES;
+                return;
             }
         }
         
-        // other finger lifted, gesture ended
-        if (!self.gestureAdditionalTouch.isActive) {
-            [self stopCurrentGesture];
+        // chosen by contact ID, so it stays the same touch while the set order changes from frame to frame
+        TUCTouch *otherTouch = nil;
+        for (TUCTouch *touch in touches) {
+            if (touch.uuid != cursorTouch.uuid && (otherTouch == nil || touch.contactID < otherTouch.contactID)) {
+                otherTouch = touch;
+            }
         }
+        self.gestureAdditionalTouch = otherTouch;
         
-        
-        if(self.identifiedMultitouchGesture != _TUCCursorGestureNone) {
+        if (self.identifiedMultitouchGesture != _TUCCursorGestureNone) {
             [self performMouseEventForGesture:self.identifiedMultitouchGesture];
-            return;
         }
         
+        // until the fingers moved far enough to tell the gesture, the cursor stays where it is
+        return;
     }
     
 
@@ -329,7 +528,6 @@
     TUCTouch *touch = self.cursorTouch;
     
     CGPoint screenLocation = [self convertScreenPointRelativeToAbsolute:touch.location];
-    CGPoint location2ndFinger = [self convertScreenPointRelativeToAbsolute:self.gestureAdditionalTouch.location];
     
     TUCCursorUtilities *utils = [TUCCursorUtilities sharedInstance];
     
@@ -350,6 +548,7 @@
             [utils moveCursorTo:screenLocation];
             if ([self isLocationOutsideFrontmostWindow:screenLocation]) {
                 [utils performClickAt:screenLocation];
+                self.cursorTouchDidClickOnTouchDown = YES;
             }
             
             break;
@@ -377,19 +576,61 @@
             CGPoint prevLocation = [self convertScreenPointRelativeToAbsolute:touch.previousLocation];
             CGPoint translation = CGPointMake(screenLocation.x - prevLocation.x,
                                               screenLocation.y - prevLocation.y);
-            [utils scroll:translation phase:touch.phase];
+            
+            // momentum continues with the velocity of the recent motion, in points per second
+            CGSize screenSize = [self touchscreen].frame.size;
+            TUCDigitizerProfile profile = self.digitizerProfile;
+            CGPoint velocity = [touch velocityOverInterval:TUCDigitizerProfileVelocityWindow(&profile)];
+            [utils scroll:translation phase:touch.phase
+                 velocity:CGPointMake(velocity.x * screenSize.width, velocity.y * screenSize.height)];
             
             break; }
             
         case TUCCursorActionMagnify:
-            [utils magnifyLocationA:screenLocation
-                          locationB:location2ndFinger
-            relativeP1:self.cursorTouch.location relP2:self.gestureAdditionalTouch.location];
+        case TUCCursorActionRotate: {
+            [self performTransformWithAction:action around:[self multitouchCenter]];
             
             if (touch.phase == NSTouchPhaseEnded || self.gestureAdditionalTouch.phase == NSTouchPhaseEnded) {
                 [utils stopMagnifying];
+                [utils stopRotating];
             }
-            break;
+            break; }
+            
+        case TUCCursorActionNavigateHistory:
+        case TUCCursorActionSwitchSpace: {
+            TUCMultitouchState state = self.multitouchState;
+            int dx, dy;
+            TUCMultitouchSwipeDirection(&state, &dx, &dy);
+            
+            if (action == TUCCursorActionNavigateHistory) {
+                [utils navigateHistoryInDirection:CGPointMake(dx, dy)];
+            } else {
+                [utils switchSpaceInDirection:CGPointMake(dx, dy)];
+            }
+            break; }
+    }
+}
+
+
+/**
+ Posts the fitted transform of the fingers. A pinch that clearly turns as well also rotates, and a rotation that clearly
+ scales also magnifies, as long as the other gesture is mapped to that action too.
+ */
+- (void)performTransformWithAction:(TUCCursorAction)action around:(CGPoint)center {
+    TUCCursorUtilities *utils = [TUCCursorUtilities sharedInstance];
+    TUCSimilarityTransform delta = self.multitouchDelta;
+    
+    BOOL magnifies = action == TUCCursorActionMagnify
+        || (delta.scale != 1 && [self actionForGesture:TUCCursorGesturePinch] == TUCCursorActionMagnify);
+    BOOL rotates = action == TUCCursorActionRotate
+        || (delta.rotation != 0 && [self actionForGesture:TUCCursorGestureTwoFingerRotate] == TUCCursorActionRotate);
+    
+    if (magnifies) {
+        [utils magnifyBy:delta.scale - 1 around:center];
+    }
+    if (rotates) {
+        // contacts are in screen orientation with y pointing down, so a positive angle turns clockwise
+        [utils rotateBy:-delta.rotation * 180.0 / M_PI around:center];
     }
 }
 
@@ -410,11 +651,131 @@
         case TUCCursorGestureTwoFingerDrag:     return TUCCursorActionDrag;
             
         case TUCCursorGesturePinch:             return TUCCursorActionMagnify;
+        case TUCCursorGestureTwoFingerRotate:   return TUCCursorActionRotate;
+        case TUCCursorGestureThreeFingerSwipe:  return TUCCursorActionNavigateHistory;
+        case TUCCursorGestureFourFingerSwipe:   return TUCCursorActionSwitchSpace;
+        case TUCCursorGestureTwoFingerScroll:   return TUCCursorActionScroll;
         case _TUCCursorGestureNone:             return TUCCursorActionNone;
     }
 }
 
 
+
+#pragma mark - Multi-Finger Gestures
+
+/**
+ Collects the active touches in mm and feeds them into the recognizer. Only the `TUC_GESTURE_MAX_CONTACTS` touches with the
+ lowest contact IDs count, so a palm on the screen cannot make a frame expensive, and the set does not change with the order of the touches.
+ */
+- (TUCMultitouchKind)updateMultitouchStateWithTouches:(NSArray<TUCTouch *> *)touches {
+    TUCContactPoint contacts[TUC_GESTURE_MAX_CONTACTS];
+    uint32_t count = 0;
+    
+    CGSize size = [self touchscreen].physicalSize;
+    
+    for (TUCTouch *touch in touches) {
+        TUCContactPoint contact = { touch.contactID, touch.location.x * size.width, touch.location.y * size.height };
+        TUCContactSetInsert(contacts, &count, contact);
+    }
+    
+    TUCMultitouchState state = self.multitouchState;
+    TUCSimilarityTransform delta;
+    TUCMultitouchKind kind = TUCMultitouchUpdate(&state, contacts, count, &delta);
+    
+    self.multitouchState = state;
+    self.multitouchDelta = delta;
+    return kind;
+}
+
+
+/**
+ Centroid of the contacts the transform was fitted to, in screen coordinates. Scale and rotation are fitted around it.
+ */
+- (CGPoint)multitouchCenter {
+    TUCMultitouchState state = self.multitouchState;
+    CGSize size = [self touchscreen].physicalSize;
+    CGPoint relative = CGPointMake(state.current.centroidX / size.width, state.current.centroidY / size.height);
+    return [self convertScreenPointRelativeToAbsolute:relative];
+}
+
+
+- (TUCCursorGesture)gestureForMultitouchKind:(TUCMultitouchKind)kind numberOfTouches:(NSUInteger)numberOfTouches {
+    switch (kind) {
+        case TUCMultitouchKindNone:     return _TUCCursorGestureNone;
+        case TUCMultitouchKindScroll:   return TUCCursorGestureTwoFingerScroll;
+        case TUCMultitouchKindPinch:    return TUCCursorGesturePinch;
+        case TUCMultitouchKindRotate:   return TUCCursorGestureTwoFingerRotate;
+        case TUCMultitouchKindSwipe:
+            if (numberOfTouches == 3) {
+                return TUCCursorGestureThreeFingerSwipe;
+            } else if (numberOfTouches == 4) {
+                return TUCCursorGestureFourFingerSwipe;
+            }
+            return _TUCCursorGestureNone;
+    }
+}
+
+
+#pragma mark - Speculative Touch Down
+
+/**
+ Sends the mouse down for a cursor touch that stayed still for the hold duration, if it may still become a tap.
+ After the hold, moving makes it a drag instead of a scroll, so the press can only end as a click or a drag.
+ */
+- (void)beginSpeculativePressIfPossible {
+    if (   !self.speculativeTouchDown
+        || self.cursorTouchWasPressed
+        || self.cursorTouchDidClickOnTouchDown
+        || !self.cursorTouchQualifiedForTap
+        || !self.cursorTouchDidHold
+        || self.identifiedMultitouchGesture != _TUCCursorGestureNone
+        || [[self activeTouches] count] != 1
+        || [self actionForGesture:TUCCursorGestureTap] != TUCCursorActionClick
+        || [self actionForGesture:TUCCursorGestureHoldAndDrag] != TUCCursorActionDrag) {
+        return;
+    }
+    
+    CGPoint screenLocation = [self convertScreenPointRelativeToAbsolute:self.cursorTouch.location];
+    [[TUCCursorUtilities sharedInstance] beginSpeculativePressAt:screenLocation];
+    self.cursorTouchWasPressed = YES;
+}
+
+
+/**
+ Decides what a pending speculative press turns into, once the touches of this report tell which gesture it is.
+ Runs before the gesture is processed, so the regular handling never sees a pending press.
+ */
+- (void)resolveSpeculativePress {
+    TUCCursorUtilities *utils = [TUCCursorUtilities sharedInstance];
+    if (!utils.isPressingSpeculatively) {
+        return;
+    }
+    
+    TUCTouch *touch = self.cursorTouch;
+    NSTouchPhase phase = touch.phase;
+    
+    if (touch == nil || phase == NSTouchPhaseCancelled) {
+        [utils cancelSpeculativePress];
+        
+    } else if (phase == NSTouchPhaseEnded) {
+        if (self.cursorTouchQualifiedForTap) {
+            [utils commitSpeculativePressAsClickAt:[self convertScreenPointRelativeToAbsolute:touch.location]];
+        } else {
+            [utils cancelSpeculativePress];
+        }
+        
+    } else if ([[self activeTouches] count] > 1) {
+        // secondary click, pinch, ...
+        [utils cancelSpeculativePress];
+        
+    } else if (!self.cursorTouchQualifiedForTap) {
+        // the finger moved after the hold
+        [utils commitSpeculativePressAsDrag];
+    }
+}
+
+
+
 #pragma mark - Touch Set
 
 /**
@@ -461,7 +822,9 @@
 
 
 /**
- Removes a touch from the touch set. As a previous touch might be important for gesture evaluation, it is removed after half a second
+ Removes a touch from the touch set. As a previous touch might be important for gesture evaluation, it is removed after half a second.
+ Instant removals happen while a report is processed and are part of the next frame.
+ Delayed removals are reclaimed with the next report, or by a single timer for all of them if no report comes in before.
  */
 - (void)removeTouch:(TUCTouch *)touch now:(BOOL)instantDeletion{
 //    if (touch.uuid == self.touchUsedForCursor.uuid) {
@@ -471,24 +834,256 @@
     
     if (instantDeletion) {
         [[self touchSet] removeObject:touch];
-        [[self delegate] touchesDidChange];
+        [self.reclaimDeadlines removeObjectForKey:touch.uuid];
         return;
     }
     
-    __weak id weakSelf = self;
-    NSUUID *uuid = touch.uuid;
-    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, NSEC_PER_SEC / 2), dispatch_get_main_queue(), ^{
-        for(TUCTouch *touch in [weakSelf touchSet]) {
-            if (touch.uuid == uuid && [[weakSelf touchSet] containsObject:touch]) {
-                [[weakSelf touchSet] removeObject:touch];
-                [[weakSelf delegate] touchesDidChange];
-                return;
-            }
+    if (self.reclaimDeadlines[touch.uuid] == nil) {
+        NSTimeInterval deadline = [[NSProcessInfo processInfo] systemUptime] + TUC_TOUCH_RECLAIM_DELAY;
+        self.reclaimDeadlines[touch.uuid] = @(deadline);
+    }
+    [self scheduleReclaim];
+}
+
+
+/**
+ Removes all touches whose delay is over. Returns YES if the touch set changed.
+ */
+- (BOOL)reclaimEndedTouches {
+    if (self.reclaimDeadlines.count == 0) {
+        return NO;
+    }
+    
+    NSTimeInterval now = [[NSProcessInfo processInfo] systemUptime];
+    BOOL didRemove = NO;
+    
+    for (TUCTouch *touch in [self.touchSet allObjects]) {
+        NSNumber *deadline = self.reclaimDeadlines[touch.uuid];
+        if (deadline != nil && deadline.doubleValue <= now) {
+            [self.touchSet removeObject:touch];
+            didRemove = YES;
         }
+    }
+    
+    // forget deadlines of touches that are gone or expired
+    for (NSUUID *uuid in [self.reclaimDeadlines allKeys]) {
+        if (self.reclaimDeadlines[uuid].doubleValue <= now) {
+            [self.reclaimDeadlines removeObjectForKey:uuid];
+        }
+    }
+    return didRemove;
+}
+
+
+/**
+ Makes sure one timer is pending for the earliest deadline. Reports that arrive before reclaim on their own.
+ */
+- (void)scheduleReclaim {
+    if (self.isReclaimScheduled || self.reclaimDeadlines.count == 0) {
+        return;
+    }
+    
+    NSTimeInterval earliest = [[[self.reclaimDeadlines allValues] valueForKeyPath:@"@min.doubleValue"] doubleValue];
+    NSTimeInterval delay = MAX(0, earliest - [[NSProcessInfo processInfo] systemUptime]);
+    self.isReclaimScheduled = YES;
+    
+    __weak TUCTouchInputManager *weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        TUCTouchInputManager *manager = weakSelf;
+        manager.isReclaimScheduled = NO;
+        
+        if ([manager reclaimEndedTouches]) {
+            [manager publishFrame];
+        }
+        [manager scheduleReclaim];
+        [manager enterIdleIfPossible];
     });
 }
 
 
+
+#pragma mark - Idle State & Power Accounting
+
+/**
+ Idle means no touches and no momentum scrolling. Nothing is scheduled in this state, the next report wakes the manager up again.
+ */
+- (void)enterIdleIfPossible {
+    if (   self.isIdle
+        || self.touchSet.count > 0
+        || self.reclaimDeadlines.count > 0
+        || [[TUCCursorUtilities sharedInstance] isMomentumScrolling]) {
+        return;
+    }
+    
+    [self accountPowerState];
+    self.isIdle = YES;
+}
+
+
+- (void)leaveIdle {
+    if (!self.isIdle) {
+        return;
+    }
+    
+    [self accountPowerState];
+    self.isIdle = NO;
+}
+
+
+/**
+ Adds the usage since the last state change to the state that ends now.
+ */
+- (void)accountPowerState {
+    TUCUsageSample now = SampleUsage();
+    TUCUsageSample start = self.powerStateStart;
+    
+    TUCUsageSample delta = {
+        now.durationNs - start.durationNs,
+        now.cpuNs - start.cpuNs,
+        now.wakeups - start.wakeups
+    };
+    
+    TUCUsageSample total = self.isIdle ? self.idleUsage : self.activeUsage;
+    total.durationNs += delta.durationNs;
+    total.cpuNs      += delta.cpuNs;
+    total.wakeups    += delta.wakeups;
+    
+    if (self.isIdle) {
+        self.idleUsage = total;
+    } else {
+        self.activeUsage = total;
+    }
+    self.powerStateStart = now;
+    
+    TUCTrace(TUCTraceLevelInfo, TUCTraceEventPowerState, self.isIdle, delta.durationNs / 1000, delta.cpuNs / 1000, delta.wakeups);
+}
+
+
+- (TUCPowerStatistics *)powerStatistics {
+    // include the running state up to now without ending it
+    TUCUsageSample now = SampleUsage();
+    TUCUsageSample start = self.powerStateStart;
+    TUCUsageSample active = self.activeUsage;
+    TUCUsageSample idle = self.idleUsage;
+    
+    TUCUsageSample *current = self.isIdle ? &idle : &active;
+    current->durationNs += now.durationNs - start.durationNs;
+    current->cpuNs      += now.cpuNs - start.cpuNs;
+    current->wakeups    += now.wakeups - start.wakeups;
+    
+    return [[TUCPowerStatistics alloc] initWithActiveDuration:active.durationNs / 1e9
+                                                      cpuTime:active.cpuNs / 1e9
+                                                      wakeups:active.wakeups
+                                                 idleDuration:idle.durationNs / 1e9
+                                                      cpuTime:idle.cpuNs / 1e9
+                                                      wakeups:idle.wakeups];
+}
+
+
+- (void)resetPowerStatistics {
+    TUCUsageSample zero = { 0, 0, 0 };
+    self.activeUsage = zero;
+    self.idleUsage = zero;
+    self.powerStateStart = SampleUsage();
+}
+
+
+
+#pragma mark - Digitizer Profile
+
+/**
+ Measures the report rate; the noise floor is sampled from resting touches in `updateTouch:withLocation:...`.
+ Once the rate is known, a touchscreen in high latency mode is switched to normal latency and measured again,
+ so the trace shows the rate before and after.
+ */
+- (void)updateDigitizerProfile {
+    TUCDigitizerProfile profile = self.digitizerProfile;
+    BOOL didSettle = TUCDigitizerProfileAddReport(&profile, [self timestampOfCurrentReport]);
+    
+    if (didSettle) {
+        TUCTrace(TUCTraceLevelInfo, TUCTraceEventDigitizerProfile,
+                 TUCTraceDouble(TUCDigitizerProfileReportRate(&profile)), TUCTraceDouble(profile.noise),
+                 TUCTraceDouble(TUCDigitizerProfileStationarySpeed(&profile)), 0);
+        
+        if (HIDApplyPendingConfiguration()) {
+            TUCDigitizerProfileReset(&profile);
+        }
+    }
+    self.digitizerProfile = profile;
+}
+
+
+- (double)measuredReportRate {
+    TUCDigitizerProfile profile = self.digitizerProfile;
+    return TUCDigitizerProfileReportRate(&profile);
+}
+
+- (CGFloat)measuredNoiseFloor {
+    return self.digitizerProfile.noise;
+}
+
+- (CGFloat)stationarySpeed {
+    TUCDigitizerProfile profile = self.digitizerProfile;
+    return TUCDigitizerProfileStationarySpeed(&profile);
+}
+
+
+
+#pragma mark - Ingestion Statistics
+
+- (TUCIngestionStatistics *)ingestionStatistics {
+    HIDIngestionCounters counters;
+    HIDGetIngestionCounters(&counters);
+    
+    return [[TUCIngestionStatistics alloc] initWithReports:counters.reports
+                                                dispatched:counters.dispatchedReports
+                                                    merged:counters.mergedReports
+                                                   dropped:counters.droppedReports
+                                                maxBacklog:counters.maxBacklog
+                                                    maxLag:counters.maxLagNs / 1e9];
+}
+
+- (void)resetIngestionStatistics {
+    HIDResetIngestionCounters();
+}
+
+
+
+#pragma mark - Frame Pipeline
+
+- (BOOL)insertFrameStageNamed:(NSString *)name function:(HIDFrameStageFunction)function context:(void *)context
+                  beforeStage:(NSString *)nextStage {
+    return HIDInsertFrameStage([name UTF8String], function, context, [nextStage UTF8String]);
+}
+
+- (BOOL)removeFrameStageNamed:(NSString *)name {
+    return HIDRemoveFrameStage([name UTF8String]);
+}
+
+
+- (NSArray<TUCFrameStageStatistics *> *)frameStageStatistics {
+    HIDFramePipeline pipeline;
+    HIDCopyFramePipeline(&pipeline);
+    NSMutableArray<TUCFrameStageStatistics *> *statistics = [NSMutableArray arrayWithCapacity:pipeline.numStages];
+    
+    for (uint32_t i=0; i<pipeline.numStages; i++) {
+        const HIDFrameStage *stage = &pipeline.stages[i];
+        double average = stage->numFrames > 0 ? (double)stage->totalNs / stage->numFrames : 0;
+        
+        [statistics addObject:[[TUCFrameStageStatistics alloc] initWithName:@(stage->name)
+                                                                    enabled:stage->isEnabled
+                                                                     frames:stage->numFrames
+                                                            averageDuration:average / 1e9
+                                                                maxDuration:stage->maxNs / 1e9]];
+    }
+    return statistics;
+}
+
+- (void)resetFrameStageStatistics {
+    HIDResetFrameStageTimings();
+}
+
+
 /**
  Checks the touch set if a touch exists
  */
@@ -518,6 +1113,42 @@
 
 
 
+#pragma mark - Pen
+
+/**
+ Called on the pen thread for every pen report. The touch set is not involved, so the main thread never waits for the pen.
+ */
+- (void)updatePenAt:(CGPoint)digitizerPoint pressure:(CGFloat)pressure tilt:(CGPoint)digitizerTilt
+            inRange:(BOOL)isInRange tipSwitch:(BOOL)isTipDown barrelSwitch:(BOOL)isBarrelPressed eraser:(BOOL)isEraser {
+    
+    if (!self.postMouseEvents) {
+        return;
+    }
+    
+    // the screen settings belong to the main thread, the pen thread only reads the copy
+    os_unfair_lock_lock(&_penScreenLock);
+    TUCScreenGeometry screen = _penScreen;
+    BOOL hasScreen = _hasPenScreen;
+    os_unfair_lock_unlock(&_penScreenLock);
+    
+    if (!hasScreen) {
+        return;
+    }
+    
+    CGPoint point = TUCScreenGeometryConvertDigitizerPoint(&screen, digitizerPoint);
+    CGPoint location = TUCScreenGeometryConvertRelativeToAbsolute(&screen, point);
+    
+    // tilt is a direction, it turns with the screen like the difference of two points
+    CGPoint origin = TUCScreenGeometryConvertDigitizerPoint(&screen, CGPointMake(0.5, 0.5));
+    CGPoint tip = TUCScreenGeometryConvertDigitizerPoint(&screen, CGPointMake(0.5 + digitizerTilt.x, 0.5 + digitizerTilt.y));
+    CGPoint tilt = CGPointMake(tip.x - origin.x, tip.y - origin.y);
+    
+    [[TUCCursorUtilities sharedInstance] updatePenAt:location pressure:pressure tilt:tilt
+                                             inRange:isInRange tipDown:isTipDown barrelSwitch:isBarrelPressed eraser:isEraser];
+}
+
+
+
 #pragma mark - Screen Characteristics
 
 /**
@@ -525,21 +1156,8 @@
  If the display is rotated, we need to rotate these points
  */
 - (CGPoint)convertDigitizerPointToRelativeScreenPoint:(CGPoint)devicePoint {
-    CGFloat rotation = [self touchscreen].rotation;
-    if (rotation == 0) {
-        return devicePoint;
-        
-    } else if (rotation == 180) {
-        return CGPointMake(1 - devicePoint.x, 1 - devicePoint.y);
-        
-    } else if (rotation == 90) {
-        return CGPointMake(1 - devicePoint.y, devicePoint.x);
-        
-    } else if (rotation == 270) {
-        return CGPointMake(devicePoint.y, 1 - devicePoint.x);
-    }
-    
-    return devicePoint;
+    TUCScreenGeometry geometry = [[self touchscreen] geometry];
+    return TUCScreenGeometryConvertDigitizerPoint(&geometry, devicePoint);
 }
 
 
@@ -644,10 +1262,32 @@
 - (instancetype)init {
     if(self = [super init]) {
         self.touchSet = [NSMutableSet new];
+        _penScreenLock = OS_UNFAIR_LOCK_INIT;
+        
+        self.beganContactIDs     = [NSMutableIndexSet new];
+        self.movedContactIDs     = [NSMutableIndexSet new];
+        self.endedContactIDs     = [NSMutableIndexSet new];
+        self.cancelledContactIDs = [NSMutableIndexSet new];
+        self.currentFrame = [[TUCTouchFrame alloc] initWithFrameID:0 touches:@[]
+                                                             began:self.beganContactIDs moved:self.movedContactIDs
+                                                             ended:self.endedContactIDs cancelled:self.cancelledContactIDs];
+        self.reclaimDeadlines = [NSMutableDictionary new];
+        
+        self.isIdle = YES;
+        [self resetPowerStatistics];
+        
+        __weak TUCTouchInputManager *weakSelf = self;
+        [[TUCCursorUtilities sharedInstance] setMomentumScrollDidStop:^{
+            [weakSelf enterIdleIfPossible];
+        }];
         self.postMouseEvents = YES;
         
         self.cursorTouchQualifiedForTap = NO;
-        self.cursorTouchStationarySinceDate = nil;
+        self.cursorTouchStationarySince = 0;
+        
+        TUCDigitizerProfile profile;
+        TUCDigitizerProfileReset(&profile);
+        self.digitizerProfile = profile;
         
         self.currentFrameID = 0;
         self.identifiedMultitouchGesture = _TUCCursorGestureNone;
@@ -657,6 +1297,7 @@
         self.errorResistance = 0;
         
         self.ignoreOriginTouches = NO;
+        self.speculativeTouchDown = NO;
     }
     return self;
 }
@@ -687,6 +1328,14 @@
 
 #pragma mark - Bridge calls of C Header to Objective-C
 
+void TouchInputManagerSetReportTimestamp(void *self, uint64_t timestamp) {
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    [(__bridge id)self setReportTimestamp:(double)timestamp * timebase.numer / timebase.denom / 1e9];
+}
+
 void TouchInputManagerUpdateTouchPosition(void *self, CFIndex contactID, CGFloat x, CGFloat y, Boolean onSurface, Boolean isValid) {
     CGPoint point = CGPointMake(x, y);
     [(__bridge id)self updateTouch:(NSInteger)contactID withLocation:point onSurface:onSurface tooLargeForFinger:isValid];
@@ -701,6 +1350,14 @@ void TouchInputManagerDidProcessReport(void *self) {
     [(__bridge id)self didProcessReport];
 }
 
+void TouchInputManagerRecognizeGestures(void *self) {
+    [(__bridge id)self recognizeGestures];
+}
+
+void TouchInputManagerPublishFrame(void *self) {
+    [(__bridge id)self finishFrame];
+}
+
 void TouchInputManagerDidConnectTouchscreen(void *self) {
     [(__bridge id)self didConnectTouchscreen];
 }
@@ -709,5 +1366,11 @@ void TouchInputManagerDidDisconnectTouchscreen(void *self) {
     [(__bridge id)self didDisconnectTouchscreen];
 }
 
+void TouchInputManagerUpdatePen(void *self, CGFloat x, CGFloat y, CGFloat pressure, CGFloat tiltX, CGFloat tiltY,
+                                Boolean inRange, Boolean tipSwitch, Boolean barrelSwitch, Boolean eraser) {
+    [(__bridge id)self updatePenAt:CGPointMake(x, y) pressure:pressure tilt:CGPointMake(tiltX, tiltY)
+                           inRange:inRange tipSwitch:tipSwitch barrelSwitch:barrelSwitch eraser:eraser];
+}
+
 
 @end
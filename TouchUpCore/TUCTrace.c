@@ -0,0 +1,314 @@
+//
+//  TUCTrace.c
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#include "TUCTrace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <mach/mach_time.h>
+#include <dispatch/dispatch.h>
+
+#pragma mark - Per-Thread Rings
+
+#define TUC_TRACE_RING_CAPACITY 4096 // records, must be a power of two
+#define TUC_TRACE_RING_MASK     (TUC_TRACE_RING_CAPACITY - 1)
+
+/**
+ Single producer (the owning thread), single consumer (the writer).
+ When its thread exits, a ring is retired and freed by the consumer once its records are written.
+ */
+typedef struct TUCTraceRing {
+    TUCTraceRecord          records[TUC_TRACE_RING_CAPACITY];
+    _Atomic uint64_t        head;
+    _Atomic uint64_t        tail;
+    _Atomic uint64_t        dropped;
+    _Atomic bool            isRetired;
+    bool                    canFree;    // consumer only: was retired before its last drain
+    uint32_t                thread;
+    struct TUCTraceRing    *next;
+} TUCTraceRing;
+
+
+_Atomic int gTUCTraceRuntimeLevel = TUCTraceLevelOff;
+
+static _Thread_local TUCTraceRing *tThreadRing;
+
+static TUCTraceRing * _Atomic gRings;
+
+static pthread_key_t        gRingKey;
+static pthread_once_t       gRingKeyOnce = PTHREAD_ONCE_INIT;
+
+// producers inside TUCTraceEmit, so TUCTraceStop can wait for them before the last drain
+static _Atomic uint32_t     gActiveEmitters;
+
+static FILE                *gTraceFile;
+static pthread_t            gWriterThread;
+static dispatch_semaphore_t gWriterSignal;
+static _Atomic bool         gWriterRunning;
+static _Atomic bool         gWriterShouldStop;
+
+
+
+/**
+ Thread exit. The consumer frees the ring, it may still hold records that were not written.
+ */
+static void RetireRing(void *value) {
+    TUCTraceRing *ring = value;
+    tThreadRing = NULL;
+    atomic_store_explicit(&ring->isRetired, true, memory_order_release);
+}
+
+
+static void CreateRingKey(void) {
+    pthread_key_create(&gRingKey, RetireRing);
+}
+
+
+static TUCTraceRing *RingForCurrentThread(void) {
+    if (tThreadRing) {
+        return tThreadRing;
+    }
+
+    pthread_once(&gRingKeyOnce, CreateRingKey);
+
+    TUCTraceRing *ring = calloc(1, sizeof(TUCTraceRing));
+    if (!ring) {
+        return NULL;
+    }
+
+    uint64_t threadID = 0;
+    pthread_threadid_np(NULL, &threadID);
+    ring->thread = (uint32_t)threadID;
+
+    // lock-free push, the writer only ever walks the list
+    TUCTraceRing *first = atomic_load_explicit(&gRings, memory_order_relaxed);
+    do {
+        ring->next = first;
+    } while (!atomic_compare_exchange_weak_explicit(&gRings, &first, ring, memory_order_release, memory_order_relaxed));
+
+    tThreadRing = ring;
+    pthread_setspecific(gRingKey, ring);
+    return ring;
+}
+
+
+
+static void EmitRecord(TUCTraceLevel level, TUCTraceEvent event, int64_t a0, int64_t a1, int64_t a2, int64_t a3) {
+    TUCTraceRing *ring = RingForCurrentThread();
+    if (!ring) {
+        return;
+    }
+
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (head - tail >= TUC_TRACE_RING_CAPACITY) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    TUCTraceRecord *record = &ring->records[head & TUC_TRACE_RING_MASK];
+    record->timestamp = mach_absolute_time();
+    record->thread    = ring->thread;
+    record->event     = (uint16_t)event;
+    record->level     = (uint8_t)level;
+    record->reserved  = 0;
+    record->args[0]   = a0;
+    record->args[1]   = a1;
+    record->args[2]   = a2;
+    record->args[3]   = a3;
+
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    // wake the writer exactly once per half ring, it sleeps otherwise
+    if (head + 1 - tail == TUC_TRACE_RING_CAPACITY / 2 && atomic_load_explicit(&gWriterRunning, memory_order_relaxed)) {
+        dispatch_semaphore_signal(gWriterSignal);
+    }
+}
+
+
+
+void TUCTraceEmit(TUCTraceLevel level, TUCTraceEvent event, int64_t a0, int64_t a1, int64_t a2, int64_t a3) {
+    // checked again after announcing the producer: either TUCTraceStop sees it and waits, or it sees the level turned off
+    atomic_fetch_add(&gActiveEmitters, 1);
+    if ((int)level <= atomic_load(&gTUCTraceRuntimeLevel)) {
+        EmitRecord(level, event, a0, a1, a2, a3);
+    }
+    atomic_fetch_sub_explicit(&gActiveEmitters, 1, memory_order_release);
+}
+
+
+
+#pragma mark - Writer
+
+static void DrainRing(TUCTraceRing *ring) {
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    while (tail != head) {
+        uint64_t start = tail & TUC_TRACE_RING_MASK;
+        uint64_t count = head - tail;
+        if (start + count > TUC_TRACE_RING_CAPACITY) {
+            count = TUC_TRACE_RING_CAPACITY - start; // write up to the wrap first
+        }
+
+        fwrite(&ring->records[start], sizeof(TUCTraceRecord), count, gTraceFile);
+        tail += count;
+    }
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+
+    uint64_t dropped = atomic_exchange_explicit(&ring->dropped, 0, memory_order_relaxed);
+    if (dropped > 0) {
+        TUCTraceRecord record = {
+            .timestamp = mach_absolute_time(),
+            .thread    = ring->thread,
+            .event     = TUCTraceEventTraceDropped,
+            .level     = TUCTraceLevelError,
+            .args      = { (int64_t)dropped, 0, 0, 0 }
+        };
+        fwrite(&record, sizeof(TUCTraceRecord), 1, gTraceFile);
+    }
+}
+
+
+/**
+ Only the consumer removes rings. Producers only push in front, so rings behind the first can be unlinked without a race.
+ The first ring is left for a later pass if a producer pushed a new one in the meantime.
+ */
+static void FreeRetiredRings(void) {
+    TUCTraceRing *first = atomic_load_explicit(&gRings, memory_order_acquire);
+    if (!first) {
+        return;
+    }
+
+    TUCTraceRing *previous = first;
+    TUCTraceRing *ring = first->next;
+    while (ring) {
+        TUCTraceRing *next = ring->next;
+        if (ring->canFree) {
+            previous->next = next;
+            free(ring);
+        } else {
+            previous = ring;
+        }
+        ring = next;
+    }
+
+    if (first->canFree && atomic_compare_exchange_strong(&gRings, &first, first->next)) {
+        free(first);
+    }
+}
+
+
+/**
+ Consumer only: the writer thread, or the thread that starts or stops the trace while there is no writer.
+ */
+static void DrainAllRings(void) {
+    for (TUCTraceRing *ring = atomic_load_explicit(&gRings, memory_order_acquire); ring; ring = ring->next) {
+        ring->canFree = atomic_load_explicit(&ring->isRetired, memory_order_acquire);
+        DrainRing(ring);
+    }
+    FreeRetiredRings();
+}
+
+
+static void *WriterMain(void *unused) {
+    pthread_setname_np("TouchUpCore.trace");
+
+    while (!atomic_load_explicit(&gWriterShouldStop, memory_order_acquire)) {
+        dispatch_semaphore_wait(gWriterSignal, DISPATCH_TIME_FOREVER);
+        DrainAllRings();
+        fflush(gTraceFile);
+    }
+    return NULL;
+}
+
+
+
+#pragma mark - Start / Stop
+
+bool TUCTraceStart(const char *path, TUCTraceLevel level) {
+    if (atomic_load(&gWriterRunning)) {
+        return false;
+    }
+
+    gTraceFile = fopen(path, "wb");
+    if (!gTraceFile) {
+        return false;
+    }
+
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+
+    TUCTraceFileHeader header = {
+        .magic          = TUC_TRACE_FILE_MAGIC,
+        .version        = TUC_TRACE_FILE_VERSION,
+        .recordSize     = sizeof(TUCTraceRecord),
+        .timebaseNumer  = timebase.numer,
+        .timebaseDenom  = timebase.denom
+    };
+    fwrite(&header, sizeof(header), 1, gTraceFile);
+
+    // whatever was recorded before the file existed is not part of this trace
+    for (TUCTraceRing *ring = atomic_load(&gRings); ring; ring = ring->next) {
+        ring->canFree = atomic_load(&ring->isRetired);
+        atomic_store(&ring->tail, atomic_load(&ring->head));
+        atomic_store(&ring->dropped, 0);
+    }
+    FreeRetiredRings();
+
+    if (!gWriterSignal) {
+        gWriterSignal = dispatch_semaphore_create(0);
+    }
+    atomic_store(&gWriterShouldStop, false);
+
+    if (pthread_create(&gWriterThread, NULL, WriterMain, NULL) != 0) {
+        fclose(gTraceFile);
+        gTraceFile = NULL;
+        return false;
+    }
+
+    atomic_store(&gWriterRunning, true);
+    TUCTraceSetLevel(level);
+    return true;
+}
+
+
+void TUCTraceStop(void) {
+    if (!atomic_load(&gWriterRunning)) {
+        return;
+    }
+
+    atomic_store(&gTUCTraceRuntimeLevel, TUCTraceLevelOff);
+    atomic_store(&gWriterRunning, false);
+    atomic_store(&gWriterShouldStop, true);
+    dispatch_semaphore_signal(gWriterSignal);
+    pthread_join(gWriterThread, NULL);
+
+    // producers that passed the level check before it was turned off finish their record first
+    while (atomic_load(&gActiveEmitters) > 0) {
+        sched_yield();
+    }
+
+    DrainAllRings();
+    fclose(gTraceFile);
+    gTraceFile = NULL;
+}
+
+
+void TUCTraceSetLevel(TUCTraceLevel level) {
+    atomic_store_explicit(&gTUCTraceRuntimeLevel, (int)level, memory_order_relaxed);
+}
+
+
+void TUCTraceFlush(void) {
+    if (atomic_load(&gWriterRunning)) {
+        dispatch_semaphore_signal(gWriterSignal);
+    }
+}
@@ -0,0 +1,159 @@
+//
+//  TUCTrace.h
+//  Touch Up Core
+//
+//  Created by agent on 18.10.26.
+//
+
+#ifndef TUCTrace_h
+#define TUCTrace_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+
+/**
+ Binary trace log for the input path.
+
+ Every call to `TUCTrace` writes one fixed-size record into a ring owned by the calling thread. Nothing is formatted and no lock is taken,
+ so tracing does not change the timing of the code it observes. A background writer drains the rings into a file, which can be turned into
+ a readable timeline with the `tuc-trace-decode` tool in the `Tools` folder.
+
+ Records below `TUC_TRACE_COMPILE_LEVEL` are removed by the compiler, records below the runtime level are skipped with a single load.
+ */
+
+typedef enum {
+    TUCTraceLevelOff     = 0,
+    TUCTraceLevelError   = 1,
+    TUCTraceLevelInfo    = 2,
+    TUCTraceLevelDebug   = 3,
+    TUCTraceLevelVerbose = 4
+} TUCTraceLevel;
+
+
+#ifndef TUC_TRACE_COMPILE_LEVEL
+#if DEBUG
+#define TUC_TRACE_COMPILE_LEVEL TUCTraceLevelVerbose
+#else
+#define TUC_TRACE_COMPILE_LEVEL TUCTraceLevelInfo
+#endif
+#endif
+
+
+/**
+ List of all trace events: X(name, argument types, argument labels...)
+ Argument types: `i` integer, `x` hexadecimal integer, `f` double (encode with `TUCTraceDouble`).
+ Shared with the decoder, so new events only have to be added here.
+ */
+#define TUC_TRACE_EVENTS(X) \
+    X(TraceDropped,       "i",    "count",   NULL,     NULL,      NULL)    \
+    X(HIDManagerError,    "",     NULL,      NULL,     NULL,      NULL)    \
+    X(DeviceMatched,      "xx",   "device",  "result", NULL,      NULL)    \
+    X(DeviceRemoved,      "xx",   "device",  "result", NULL,      NULL)    \
+    X(DeviceLayout,       "xxxi", "vendor",  "product", "hash",   "contacts") \
+    X(DecoderSelected,    "iii",  "specialized", "reportID", "size", NULL) \
+    X(DeviceSettings,     "iiii", "inputMode", "latencyMode", "contactCountMax", "contactsPerReport") \
+    X(DeviceConfigured,   "xix",  "usage",   "value",  "result",  NULL)    \
+    X(DeviceReady,        "ii",   "path",    "setupNs", NULL,     NULL)    \
+    X(FirstEvent,         "ii",   "path",    "sinceMatchNs", NULL, NULL)   \
+    X(ElementTree,        "ii",   "type",    "children", NULL,    NULL)    \
+    X(ElementCollection,  "ii",   "index",   "children", NULL,    NULL)    \
+    X(ElementChild,       "xxi",  "page",    "usage",  "cookie",  NULL)    \
+    X(HIDValue,           "ixxi", "cookie",  "page",   "usage",   "value") \
+    X(CollectionValue,    "ixxi", "cookie",  "page",   "usage",   "value") \
+    X(ReportDispatched,   "iii",  "updates", "contacts", "offset", NULL)   \
+    X(Backlog,            "iii",  "merged",  "totalMerged", "totalDropped", NULL) \
+    X(DigitizerProfile,   "fff",  "rateHz",  "noiseMm", "stationaryMmPerS", NULL) \
+    X(TouchUpdated,       "iffx", "contact", "x",      "y",       "flags") \
+    X(PenLayout,          "iiii", "reportID", "size",  "pressure", "tilt")  \
+    X(PenSample,          "fffx", "x",       "y",      "pressure", "flags") \
+    X(SpeculativePress,   "ii",   "outcome", "heldNs", NULL,      NULL)    \
+    X(PowerState,         "iiii", "endedIdle", "durationUs", "cpuUs", "wakeups")
+
+
+typedef enum {
+#define TUC_TRACE_EVENT_ENUM(name, types, a0, a1, a2, a3) TUCTraceEvent##name,
+    TUC_TRACE_EVENTS(TUC_TRACE_EVENT_ENUM)
+#undef TUC_TRACE_EVENT_ENUM
+    TUCTraceEventCount
+} TUCTraceEvent;
+
+
+/**
+ Outcome argument of the SpeculativePress event. For a click, `heldNs` is the latency the early mouse down saved.
+ */
+typedef enum {
+    TUCTracePressBegan,
+    TUCTracePressClicked,
+    TUCTracePressDragged,
+    TUCTracePressCancelled
+} TUCTracePressOutcome;
+
+
+
+#pragma mark - File Format
+
+#define TUC_TRACE_FILE_MAGIC    0x54435554 // 'TUCT'
+#define TUC_TRACE_FILE_VERSION  2
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t timebaseNumer;   // converts timestamps to ns, see mach_timebase_info
+    uint32_t timebaseDenom;
+} TUCTraceFileHeader;
+
+typedef struct {
+    uint64_t timestamp;       // mach_absolute_time
+    uint32_t thread;
+    uint16_t event;
+    uint8_t  level;
+    uint8_t  reserved;
+    int64_t  args[4];
+} TUCTraceRecord;
+
+
+
+#pragma mark - Recording
+
+extern _Atomic int gTUCTraceRuntimeLevel;
+
+#define TUCTraceIsEnabled(level) \
+    ((level) <= TUC_TRACE_COMPILE_LEVEL && (int)(level) <= atomic_load_explicit(&gTUCTraceRuntimeLevel, memory_order_relaxed))
+
+#define TUCTrace(level, event, a0, a1, a2, a3) do {                                              \
+    if (TUCTraceIsEnabled(level)) {                                                               \
+        TUCTraceEmit((level), (event), (int64_t)(a0), (int64_t)(a1), (int64_t)(a2), (int64_t)(a3)); \
+    }                                                                                             \
+} while (0)
+
+
+static inline int64_t TUCTraceDouble(double value) {
+    int64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+
+/**
+ Opens the file at `path` and starts the background writer. Returns false if the file cannot be created or a trace is already running.
+ */
+bool TUCTraceStart(const char *path, TUCTraceLevel level);
+
+/**
+ Turns tracing off, waits for threads that are still writing a record, then writes all pending records and closes the trace file.
+ */
+void TUCTraceStop(void);
+
+void TUCTraceSetLevel(TUCTraceLevel level);
+
+/**
+ Asks the writer to drain all rings now instead of waiting until one of them is half full.
+ */
+void TUCTraceFlush(void);
+
+void TUCTraceEmit(TUCTraceLevel level, TUCTraceEvent event, int64_t a0, int64_t a1, int64_t a2, int64_t a3);
+
+#endif /* TUCTrace_h */
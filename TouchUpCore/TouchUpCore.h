@@ -17,5 +17,12 @@ FOUNDATION_EXPORT const unsigned char TouchUpCoreVersionString[];
 #import<TouchUpCore/TUCTouchInputManager.h>
 #import<TouchUpCore/TUCTouchDelegate.h>
 #import<TouchUpCore/TUCTouch.h>
+#import<TouchUpCore/TUCMotionHistory.h>
+#import<TouchUpCore/TUCTouchFrame.h>
+#import<TouchUpCore/TUCPowerStatistics.h>
+#import<TouchUpCore/TUCIngestionStatistics.h>
+#import<TouchUpCore/TUCFrameStageStatistics.h>
+#import<TouchUpCore/HIDFramePipeline.h>
 #import<TouchUpCore/TUCScreen.h>
+#import<TouchUpCore/TUCTrace.h>
 